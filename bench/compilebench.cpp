@@ -0,0 +1,433 @@
+/*            __ __                                                     *\
+**     __    /_// /  ___            lila bootstrap compiler             **
+**    / /   __ / /  / _ |           (c) 2016, Christian Krause          **
+**   / /__ / // /__/ __ |                                               **
+**  /____//_//____/_/ | |                                               **
+\*                    |/                                                */
+
+// Measures the throughput of each phase of the compiler on synthetic
+// programs of configurable scale.
+//
+// Each workload stresses one shape of program: many top level defs, deeply
+// nested blocks and defs, very long expressions and many vals. Tokenizing,
+// parsing, name resolution, code generation and object emission are timed
+// separately over several repetitions. Constant folding is left out, it
+// would reduce most of the generated programs to a number. The results go
+// to STDOUT as a table and to a JSON file to track them over time.
+
+#include <getopt.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/raw_ostream.h>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "backend.hpp"
+#include "codegen.hpp"
+#include "parser.hpp"
+#include "resolver.hpp"
+
+using namespace lila::backend;
+using namespace lila::codegen;
+using namespace lila::parser;
+using namespace lila::resolver;
+
+// defs calling their predecessor
+static string generateDefs(unsigned scale) {
+  string code;
+
+  for (unsigned i = 0; i < 2000 * scale; i++) {
+    string n = to_string(i);
+    code += "def f" + n + "(a, b) = {\n";
+    code += "  val x = a * " + n + ".5 + b\n";
+    code += i > 0 ? "  f" + to_string(i - 1) + "(x, b - 1) - a\n" : "  x - a\n";
+    code += "}\n";
+  }
+
+  code += "f" + to_string(2000 * scale - 1) + "(1, 2)\n";
+
+  return code;
+}
+
+// blocks and defs nested as in test/lilac-scope.sh
+static string generateNesting(unsigned scale) {
+  const unsigned depth = 64;
+  string code;
+
+  for (unsigned i = 0; i < 40 * scale; i++) {
+    string n = to_string(i);
+    string indent;
+
+    code += "def g" + n + "(a, b) = {\n";
+
+    for (unsigned d = 0; d < depth; d++) {
+      indent += "  ";
+      code += indent + "def h" + to_string(d) + "(a, b) = {\n";
+      code += indent + "  val c = a + b * " + to_string(d) + "\n";
+    }
+
+    code += indent + "  a * b\n";
+
+    for (unsigned d = depth; d-- > 0; ) {
+      code += indent + "}\n";
+      code += indent + "h" + to_string(d) + "(a, b + 2)\n";
+      indent.resize(indent.size() - 2);
+    }
+
+    code += "}\n";
+  }
+
+  code += "g0(3, 2)\n";
+
+  return code;
+}
+
+// vals of a few long expressions
+static string generateExpressions(unsigned scale) {
+  const unsigned terms = 1000;
+  string code;
+
+  for (unsigned i = 0; i < 20 * scale; i++) {
+    code += "val e" + to_string(i) + " = 1";
+
+    for (unsigned t = 0; t < terms; t++) {
+      const char *ops[] = { " + ", " * ", " - " };
+      code += ops[t % 3];
+      code += t % 5 == 0 ? "(" + to_string(t) + " + 1.25)" : to_string(t);
+    }
+
+    code += "\n";
+  }
+
+  code += "e0\n";
+
+  return code;
+}
+
+// vals each depending on the one before
+static string generateVals(unsigned scale) {
+  string code = "val v0 = 1\n";
+
+  for (unsigned i = 1; i < 10000 * scale; i++)
+    code += "val v" + to_string(i) + " = v" + to_string(i - 1) + " * 2 - " + to_string(i) + "\n";
+
+  code += "v" + to_string(10000 * scale - 1) + "\n";
+
+  return code;
+}
+
+class Workload {
+public:
+  const char *name;
+  function<string(unsigned)> generate;
+};
+
+class Phase {
+public:
+  const char *name;
+  vector<double> seconds;
+
+  double min() const {
+    return *min_element(seconds.begin(), seconds.end());
+  }
+
+  double median() const {
+    vector<double> sorted(seconds);
+    sort(sorted.begin(), sorted.end());
+    return sorted[sorted.size() / 2];
+  }
+
+  double mean() const {
+    double sum = 0;
+    for (auto s : seconds)
+      sum += s;
+    return sum / seconds.size();
+  }
+
+  double stddev() const {
+    double m = mean(), sum = 0;
+    for (auto s : seconds)
+      sum += (s - m) * (s - m);
+    return seconds.size() > 1 ? sqrt(sum / (seconds.size() - 1)) : 0;
+  }
+};
+
+class Result {
+public:
+  const char *name;
+  size_t bytes = 0;
+  size_t tokens = 0;
+  size_t nodes = 0;
+  vector<Phase> phases;
+};
+
+template<typename F>
+static auto timed(vector<double> &seconds, F f) -> decltype(f()) {
+  auto start = chrono::steady_clock::now();
+  auto result = f();
+  seconds.push_back(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+  return result;
+}
+
+static bool run(const Workload &workload, unsigned scale, unsigned repetitions, Result &result) {
+  string code = workload.generate(scale);
+
+  result.name = workload.name;
+  result.bytes = code.size();
+  result.phases = {
+    { "tokenize", {} }, { "parse", {} }, { "resolve", {} }, { "codegen", {} }, { "emit", {} }
+  };
+
+  OptLevel level;
+  string error;
+  auto target = createTargetMachine(level, error);
+
+  if (!target) {
+    cerr << error << endl;
+    return false;
+  }
+
+  for (unsigned r = 0; r < repetitions; r++) {
+    SymbolTable symbols;
+    OperatorTable operators(symbols);
+
+    auto lexerResult = timed(result.phases[0].seconds, [&]() {
+      return tokenize(llvm::MemoryBuffer::getMemBuffer(code, workload.name), symbols);
+    });
+
+    auto lexsuccess = llvm::dyn_cast<LexerSuccess>(lexerResult.get());
+    if (!lexsuccess) {
+      cerr << workload.name << ": lexer failed on generated program" << endl;
+      return false;
+    }
+
+    result.tokens = lexsuccess->tokens->size();
+
+    Parser parser(lexsuccess->tokens.get(), symbols, operators);
+
+    auto parserResult = timed(result.phases[1].seconds, [&]() {
+      return parser.parse();
+    });
+
+    auto parsesuccess = llvm::dyn_cast<ParserSuccess>(parserResult.get());
+    if (!parsesuccess) {
+      cerr << workload.name << ": parser failed on generated program" << endl;
+      return false;
+    }
+
+    result.nodes = parsesuccess->ast->size();
+
+    Resolver resolver(symbols);
+
+    auto resolverResult = timed(result.phases[2].seconds, [&]() {
+      return resolver.resolve(move(parsesuccess->ast));
+    });
+
+    auto resolvesuccess = llvm::dyn_cast<ResolverSuccess>(resolverResult.get());
+    if (!resolvesuccess) {
+      cerr << workload.name << ": resolver failed on generated program" << endl;
+      return false;
+    }
+
+    llvm::LLVMContext context;
+    CodeGen codegen(workload.name, context, symbols);
+
+    auto cgresult = timed(result.phases[3].seconds, [&]() {
+      return codegen.generateCode(move(resolvesuccess->ast));
+    });
+
+    auto cgsuccess = llvm::dyn_cast<CodegenSuccess>(cgresult.get());
+    if (!cgsuccess) {
+      cerr << workload.name << ": codegen failed on generated program" << endl;
+      return false;
+    }
+
+    auto &module = *cgsuccess->module;
+    prepareModule(module, *target, level);
+
+    bool emitted = timed(result.phases[4].seconds, [&]() {
+      return emitFile(module, *target, FileType::Object, "/dev/null", error);
+    });
+
+    if (!emitted) {
+      cerr << workload.name << ": " << error << endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static void printTable(const vector<Result> &results) {
+  printf("%-12s %-10s %10s %10s %10s %12s %14s %14s\n",
+         "workload", "phase", "median s", "min s", "stddev s", "MB/s", "tokens/s", "nodes/s");
+
+  for (auto &result : results)
+    for (auto &phase : result.phases) {
+      double median = phase.median();
+      printf("%-12s %-10s %10.4f %10.4f %10.4f %12.1f %14.0f %14.0f\n",
+             result.name, phase.name, median, phase.min(), phase.stddev(),
+             result.bytes / median / (1024 * 1024), result.tokens / median, result.nodes / median);
+    }
+}
+
+static bool writeJSON(const vector<Result> &results, unsigned scale, unsigned repetitions,
+                      const char *path) {
+  std::error_code EC;
+  llvm::raw_fd_ostream out(path, EC, llvm::sys::fs::F_Text);
+
+  if (EC) {
+    cerr << "error opening " << path << ": " << EC.message() << endl;
+    return false;
+  }
+
+  out << "{\n";
+  out << "  \"benchmark\": \"compilebench\",\n";
+#ifdef PACKAGE_STRING
+  out << "  \"version\": \"" << PACKAGE_STRING << "\",\n";
+#endif
+  out << "  \"scale\": " << scale << ",\n";
+  out << "  \"repetitions\": " << repetitions << ",\n";
+  out << "  \"workloads\": [\n";
+
+  for (size_t w = 0; w < results.size(); w++) {
+    auto &result = results[w];
+
+    out << "    {\n";
+    out << "      \"name\": \"" << result.name << "\",\n";
+    out << "      \"bytes\": " << result.bytes << ",\n";
+    out << "      \"tokens\": " << result.tokens << ",\n";
+    out << "      \"nodes\": " << result.nodes << ",\n";
+    out << "      \"phases\": [\n";
+
+    for (size_t p = 0; p < result.phases.size(); p++) {
+      auto &phase = result.phases[p];
+      double median = phase.median();
+
+      out << "        { \"name\": \"" << phase.name << "\""
+          << ", \"seconds\": [";
+      for (size_t r = 0; r < phase.seconds.size(); r++)
+        out << (r ? ", " : "") << llvm::format("%.6f", phase.seconds[r]);
+      out << "]"
+          << ", \"min\": " << llvm::format("%.6f", phase.min())
+          << ", \"median\": " << llvm::format("%.6f", median)
+          << ", \"mean\": " << llvm::format("%.6f", phase.mean())
+          << ", \"stddev\": " << llvm::format("%.6f", phase.stddev())
+          << ", \"mb_per_s\": " << llvm::format("%.3f", result.bytes / median / (1024 * 1024))
+          << ", \"tokens_per_s\": " << llvm::format("%.0f", result.tokens / median)
+          << ", \"nodes_per_s\": " << llvm::format("%.0f", result.nodes / median)
+          << " }" << (p + 1 < result.phases.size() ? "," : "") << "\n";
+    }
+
+    out << "      ]\n";
+    out << "    }" << (w + 1 < results.size() ? "," : "") << "\n";
+  }
+
+  out << "  ]\n";
+  out << "}\n";
+
+  return true;
+}
+
+// a positive decimal number that fits count
+static bool parseCount(const char *arg, unsigned &count) {
+  char *end;
+  errno = 0;
+  unsigned long value = strtoul(arg, &end, 10);
+
+  if (*arg < '0' || *arg > '9' || *end || errno == ERANGE || value == 0 || value > UINT_MAX)
+    return false;
+
+  count = value;
+  return true;
+}
+
+int main(int argc, char** argv) {
+  unsigned scale = 1;
+  unsigned repetitions = 5;
+  const char *output = "compilebench.json";
+  string only;
+
+  const char *usage =
+    "usage: compilebench [-n SCALE] [-r REPETITIONS] [-o JSON] [-w WORKLOAD]\n"
+    "\n"
+    "    -n SCALE         size of the generated programs, defaults to 1\n"
+    "    -r REPETITIONS   runs of each phase, defaults to 5\n"
+    "    -o JSON          write the results to JSON, defaults to compilebench.json\n"
+    "    -w WORKLOAD      only run one of defs, nesting, expressions, vals\n";
+
+  int c;
+  while ((c = getopt(argc, argv, "hn:r:o:w:")) != -1)
+    switch (c) {
+    case 'n':
+      if (!parseCount(optarg, scale)) {
+        cerr << "invalid scale: " << optarg << endl;
+        cerr << usage;
+        return 1;
+      }
+      break;
+    case 'r':
+      if (!parseCount(optarg, repetitions)) {
+        cerr << "invalid number of repetitions: " << optarg << endl;
+        cerr << usage;
+        return 1;
+      }
+      break;
+    case 'o':
+      output = optarg;
+      break;
+    case 'w':
+      only = optarg;
+      break;
+    case 'h':
+      cout << usage;
+      return 0;
+    default:
+      cerr << usage;
+      return 1;
+    }
+
+  const Workload workloads[] = {
+    { "defs", generateDefs },
+    { "nesting", generateNesting },
+    { "expressions", generateExpressions },
+    { "vals", generateVals }
+  };
+
+  initializeTargets();
+
+  vector<Result> results;
+
+  for (auto &workload : workloads) {
+    if (!only.empty() && only != workload.name)
+      continue;
+
+    Result result;
+    if (!run(workload, scale, repetitions, result))
+      return 1;
+
+    results.push_back(move(result));
+  }
+
+  if (results.empty()) {
+    cerr << "unknown workload: " << only << endl;
+    return 1;
+  }
+
+  printTable(results);
+
+  return writeJSON(results, scale, repetitions, output) ? 0 : 1;
+}
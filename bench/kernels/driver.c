@@ -0,0 +1,10 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+double kernel(double x);
+
+int main(int argc, char** argv) {
+  double x = argc > 1 ? atof(argv[1]) : 0.9;
+  printf("%lg\n", kernel(x));
+  return 0;
+}
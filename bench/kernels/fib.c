@@ -0,0 +1,42 @@
+double fib0(double x) { return x * x - 1; }
+double fib1(double x) { return 2 * x + 1; }
+
+double fib2(double x) { return fib1(x + 0.25) + fib0(x * 0.5); }
+double fib3(double x) { return fib2(x + 0.25) + fib1(x * 0.5); }
+double fib4(double x) { return fib3(x + 0.25) + fib2(x * 0.5); }
+double fib5(double x) { return fib4(x + 0.25) + fib3(x * 0.5); }
+double fib6(double x) { return fib5(x + 0.25) + fib4(x * 0.5); }
+double fib7(double x) { return fib6(x + 0.25) + fib5(x * 0.5); }
+double fib8(double x) { return fib7(x + 0.25) + fib6(x * 0.5); }
+double fib9(double x) { return fib8(x + 0.25) + fib7(x * 0.5); }
+double fib10(double x) { return fib9(x + 0.25) + fib8(x * 0.5); }
+double fib11(double x) { return fib10(x + 0.25) + fib9(x * 0.5); }
+double fib12(double x) { return fib11(x + 0.25) + fib10(x * 0.5); }
+double fib13(double x) { return fib12(x + 0.25) + fib11(x * 0.5); }
+double fib14(double x) { return fib13(x + 0.25) + fib12(x * 0.5); }
+double fib15(double x) { return fib14(x + 0.25) + fib13(x * 0.5); }
+double fib16(double x) { return fib15(x + 0.25) + fib14(x * 0.5); }
+double fib17(double x) { return fib16(x + 0.25) + fib15(x * 0.5); }
+double fib18(double x) { return fib17(x + 0.25) + fib16(x * 0.5); }
+double fib19(double x) { return fib18(x + 0.25) + fib17(x * 0.5); }
+double fib20(double x) { return fib19(x + 0.25) + fib18(x * 0.5); }
+double fib21(double x) { return fib20(x + 0.25) + fib19(x * 0.5); }
+double fib22(double x) { return fib21(x + 0.25) + fib20(x * 0.5); }
+double fib23(double x) { return fib22(x + 0.25) + fib21(x * 0.5); }
+double fib24(double x) { return fib23(x + 0.25) + fib22(x * 0.5); }
+double fib25(double x) { return fib24(x + 0.25) + fib23(x * 0.5); }
+double fib26(double x) { return fib25(x + 0.25) + fib24(x * 0.5); }
+double fib27(double x) { return fib26(x + 0.25) + fib25(x * 0.5); }
+double fib28(double x) { return fib27(x + 0.25) + fib26(x * 0.5); }
+double fib29(double x) { return fib28(x + 0.25) + fib27(x * 0.5); }
+double fib30(double x) { return fib29(x + 0.25) + fib28(x * 0.5); }
+double fib31(double x) { return fib30(x + 0.25) + fib29(x * 0.5); }
+double fib32(double x) { return fib31(x + 0.25) + fib30(x * 0.5); }
+double fib33(double x) { return fib32(x + 0.25) + fib31(x * 0.5); }
+double fib34(double x) { return fib33(x + 0.25) + fib32(x * 0.5); }
+double fib35(double x) { return fib34(x + 0.25) + fib33(x * 0.5); }
+double fib36(double x) { return fib35(x + 0.25) + fib34(x * 0.5); }
+double fib37(double x) { return fib36(x + 0.25) + fib35(x * 0.5); }
+double fib38(double x) { return fib37(x + 0.25) + fib36(x * 0.5); }
+
+double kernel(double x) { return fib38(x); }
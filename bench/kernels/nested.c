@@ -0,0 +1,133 @@
+double n27(double a) { return a * a - 3; }
+
+double n26(double a) {
+  double b = a * 0.75;
+  return n27(b) - n27(a + 0.5) * 0.5;
+}
+
+double n25(double a) {
+  double b = a * 0.75;
+  return n26(b) - n26(a + 0.5) * 0.5;
+}
+
+double n24(double a) {
+  double b = a * 0.75;
+  return n25(b) - n25(a + 0.5) * 0.5;
+}
+
+double n23(double a) {
+  double b = a * 0.75;
+  return n24(b) - n24(a + 0.5) * 0.5;
+}
+
+double n22(double a) {
+  double b = a * 0.75;
+  return n23(b) - n23(a + 0.5) * 0.5;
+}
+
+double n21(double a) {
+  double b = a * 0.75;
+  return n22(b) - n22(a + 0.5) * 0.5;
+}
+
+double n20(double a) {
+  double b = a * 0.75;
+  return n21(b) - n21(a + 0.5) * 0.5;
+}
+
+double n19(double a) {
+  double b = a * 0.75;
+  return n20(b) - n20(a + 0.5) * 0.5;
+}
+
+double n18(double a) {
+  double b = a * 0.75;
+  return n19(b) - n19(a + 0.5) * 0.5;
+}
+
+double n17(double a) {
+  double b = a * 0.75;
+  return n18(b) - n18(a + 0.5) * 0.5;
+}
+
+double n16(double a) {
+  double b = a * 0.75;
+  return n17(b) - n17(a + 0.5) * 0.5;
+}
+
+double n15(double a) {
+  double b = a * 0.75;
+  return n16(b) - n16(a + 0.5) * 0.5;
+}
+
+double n14(double a) {
+  double b = a * 0.75;
+  return n15(b) - n15(a + 0.5) * 0.5;
+}
+
+double n13(double a) {
+  double b = a * 0.75;
+  return n14(b) - n14(a + 0.5) * 0.5;
+}
+
+double n12(double a) {
+  double b = a * 0.75;
+  return n13(b) - n13(a + 0.5) * 0.5;
+}
+
+double n11(double a) {
+  double b = a * 0.75;
+  return n12(b) - n12(a + 0.5) * 0.5;
+}
+
+double n10(double a) {
+  double b = a * 0.75;
+  return n11(b) - n11(a + 0.5) * 0.5;
+}
+
+double n9(double a) {
+  double b = a * 0.75;
+  return n10(b) - n10(a + 0.5) * 0.5;
+}
+
+double n8(double a) {
+  double b = a * 0.75;
+  return n9(b) - n9(a + 0.5) * 0.5;
+}
+
+double n7(double a) {
+  double b = a * 0.75;
+  return n8(b) - n8(a + 0.5) * 0.5;
+}
+
+double n6(double a) {
+  double b = a * 0.75;
+  return n7(b) - n7(a + 0.5) * 0.5;
+}
+
+double n5(double a) {
+  double b = a * 0.75;
+  return n6(b) - n6(a + 0.5) * 0.5;
+}
+
+double n4(double a) {
+  double b = a * 0.75;
+  return n5(b) - n5(a + 0.5) * 0.5;
+}
+
+double n3(double a) {
+  double b = a * 0.75;
+  return n4(b) - n4(a + 0.5) * 0.5;
+}
+
+double n2(double a) {
+  double b = a * 0.75;
+  return n3(b) - n3(a + 0.5) * 0.5;
+}
+
+double n1(double a) {
+  double b = a * 0.75;
+  return n2(b) - n2(a + 0.5) * 0.5;
+}
+
+double kernel(double x) { return n1(x); }
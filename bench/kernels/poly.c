@@ -0,0 +1,29 @@
+double poly(double x) { return (((((((0.5 * x - 1.25) * x + 2) * x - 0.75) * x + 1.5) * x - 3) * x + 0.25) * x - 1) * x + 4; }
+
+double p0(double x) { return poly(x); }
+double p1(double x) { return p0(x * 0.75) + p0(x + 0.5); }
+double p2(double x) { return p1(x * 0.75) + p1(x + 0.5); }
+double p3(double x) { return p2(x * 0.75) + p2(x + 0.5); }
+double p4(double x) { return p3(x * 0.75) + p3(x + 0.5); }
+double p5(double x) { return p4(x * 0.75) + p4(x + 0.5); }
+double p6(double x) { return p5(x * 0.75) + p5(x + 0.5); }
+double p7(double x) { return p6(x * 0.75) + p6(x + 0.5); }
+double p8(double x) { return p7(x * 0.75) + p7(x + 0.5); }
+double p9(double x) { return p8(x * 0.75) + p8(x + 0.5); }
+double p10(double x) { return p9(x * 0.75) + p9(x + 0.5); }
+double p11(double x) { return p10(x * 0.75) + p10(x + 0.5); }
+double p12(double x) { return p11(x * 0.75) + p11(x + 0.5); }
+double p13(double x) { return p12(x * 0.75) + p12(x + 0.5); }
+double p14(double x) { return p13(x * 0.75) + p13(x + 0.5); }
+double p15(double x) { return p14(x * 0.75) + p14(x + 0.5); }
+double p16(double x) { return p15(x * 0.75) + p15(x + 0.5); }
+double p17(double x) { return p16(x * 0.75) + p16(x + 0.5); }
+double p18(double x) { return p17(x * 0.75) + p17(x + 0.5); }
+double p19(double x) { return p18(x * 0.75) + p18(x + 0.5); }
+double p20(double x) { return p19(x * 0.75) + p19(x + 0.5); }
+double p21(double x) { return p20(x * 0.75) + p20(x + 0.5); }
+double p22(double x) { return p21(x * 0.75) + p21(x + 0.5); }
+double p23(double x) { return p22(x * 0.75) + p22(x + 0.5); }
+double p24(double x) { return p23(x * 0.75) + p23(x + 0.5); }
+
+double kernel(double x) { return p24(x); }
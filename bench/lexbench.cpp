@@ -0,0 +1,84 @@
+/*            __ __                                                     *\
+**     __    /_// /  ___            lila bootstrap compiler             **
+**    / /   __ / /  / _ |           (c) 2016, Christian Krause          **
+**   / /__ / // /__/ __ |                                               **
+**  /____//_//____/_/ | |                                               **
+\*                    |/                                                */
+
+// Measures lexer throughput on a synthetic program.
+//
+// The benchmark only relies on tokenize() and the size() of the resulting
+// token container, so it can be built against older revisions of the lexer to
+// compare tokens per second before and after a change.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+#include "lexer.hpp"
+
+using namespace lila::lexer;
+
+static string generate(size_t size) {
+  string code;
+  code.reserve(size + 256);
+
+  for (unsigned i = 0; code.size() < size; i++) {
+    code += "def f" + to_string(i) + "(a, b) = {\n";
+    code += "  val x" + to_string(i) + " = a * 3.25 + b - " + to_string(i) + "\n";
+    code += "  x" + to_string(i) + " * (a + 17) - b\n";
+    code += "}\n";
+    code += "val v" + to_string(i) + " = f" + to_string(i) + "(1.5, 2) + 1234567 * 89\n";
+  }
+
+  code += "42\n";
+
+  return code;
+}
+
+int main(int argc, char** argv) {
+  size_t megabytes = argc > 1 ? strtoul(argv[1], nullptr, 10) : 16;
+  unsigned repetitions = argc > 2 ? strtoul(argv[2], nullptr, 10) : 5;
+
+  if (megabytes == 0 || repetitions == 0) {
+    cerr << "usage: lexbench [MEGABYTES] [REPETITIONS]" << endl;
+    return 1;
+  }
+
+  string code = generate(megabytes * 1024 * 1024);
+
+  vector<double> seconds;
+  size_t ntokens = 0;
+
+  for (unsigned r = 0; r < repetitions; r++) {
+    auto source = llvm::MemoryBuffer::getMemBuffer(code, "lexbench");
+    SymbolTable symbols;
+
+    auto start = chrono::steady_clock::now();
+    auto result = tokenize(move(source), symbols);
+    auto stop = chrono::steady_clock::now();
+
+    auto success = llvm::dyn_cast<LexerSuccess>(result.get());
+    if (!success) {
+      cerr << "lexer failed on generated program" << endl;
+      return 1;
+    }
+
+    ntokens = success->tokens->size();
+    seconds.push_back(chrono::duration<double>(stop - start).count());
+  }
+
+  sort(seconds.begin(), seconds.end());
+  double best = seconds.front();
+  double median = seconds[seconds.size() / 2];
+
+  printf("input:      %zu bytes, %zu tokens\n", code.size(), ntokens);
+  printf("best:       %.4f s, %.0f tokens/s, %.1f MB/s\n",
+         best, ntokens / best, code.size() / best / (1024 * 1024));
+  printf("median:     %.4f s, %.0f tokens/s, %.1f MB/s\n",
+         median, ntokens / median, code.size() / median / (1024 * 1024));
+
+  return 0;
+}
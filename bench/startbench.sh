@@ -0,0 +1,101 @@
+#!/bin/bash
+
+# Measures the cold start latency of lilac, i.e. the time of a whole process
+# for a one-line program, where the fixed cost of starting up outweighs the
+# compilation itself.
+#
+#   help     lilac --help, the process without any compilation
+#   error    a program with a parse error, which never reaches the backend
+#   object   a native object file for the program
+#   cached   the same object found in the cache
+#   run      the program compiled in memory and run
+
+LILAC=${LILAC:-../src/bootstrap/lilac}
+
+REPETITIONS=20
+OUTPUT=startbench.json
+
+usage="usage: startbench.sh [-r REPETITIONS] [-o JSON]
+
+    -r REPETITIONS   runs of each case, defaults to 20
+    -o JSON          write the results to JSON, defaults to startbench.json
+"
+
+while getopts "hr:o:" opt ; do
+  case $opt in
+    r) REPETITIONS=$OPTARG ;;
+    o) OUTPUT=$OPTARG ;;
+    h) echo "$usage" ; exit 0 ;;
+    *) echo "$usage" >&2 ; exit 1 ;;
+  esac
+done
+
+if [[ ! $REPETITIONS =~ ^[1-9][0-9]*$ ]] ; then
+  echo "$usage" >&2
+  exit 1
+fi
+
+TMP=$(mktemp -d)
+trap 'rm -rf $TMP' EXIT
+
+echo "21 + 21" > $TMP/program.lila
+echo "21 + )" > $TMP/error.lila
+
+# warms up the cache for the cached case
+$LILAC --cache-dir=$TMP/cache -o $TMP/cached.o $TMP/program.lila || exit 1
+
+CASES=(help error object cached run)
+
+COMMANDS=(
+  "$LILAC --help"
+  "$LILAC -o $TMP/error.o $TMP/error.lila"
+  "$LILAC -o $TMP/object.o $TMP/program.lila"
+  "$LILAC --cache-dir=$TMP/cache -o $TMP/cached.o $TMP/program.lila"
+  "$LILAC --run $TMP/program.lila"
+)
+
+printf "%-8s %12s %12s %12s\n" case "min [ms]" "median [ms]" "mean [ms]"
+
+RESULTS=()
+
+for i in "${!CASES[@]}" ; do
+  times=()
+
+  for r in $(seq 1 $REPETITIONS) ; do
+    start=$(date +%s%N)
+    ${COMMANDS[$i]} > /dev/null 2>&1
+    end=$(date +%s%N)
+
+    times+=($((end - start)))
+  done
+
+  result=$(printf "%s\n" "${times[@]}" | sort -n | awk '
+    { t[NR] = $1 ; sum += $1 }
+    END {
+      median = NR % 2 ? t[(NR + 1) / 2] : (t[NR / 2] + t[NR / 2 + 1]) / 2
+      printf "%d %d %d", t[1], median, sum / NR
+    }')
+
+  set -- $result
+  awk -v c=${CASES[$i]} -v a=$1 -v b=$2 -v m=$3 'BEGIN {
+    printf "%-8s %12.2f %12.2f %12.2f\n", c, a / 1e6, b / 1e6, m / 1e6
+  }'
+
+  RESULTS+=("${CASES[$i]} $result")
+done
+
+{
+  echo "{"
+  echo "  \"repetitions\": $REPETITIONS,"
+  echo "  \"results\": ["
+
+  for i in "${!RESULTS[@]}" ; do
+    set -- ${RESULTS[$i]}
+    separator=$([[ $((i + 1)) -lt ${#RESULTS[@]} ]] && echo ",")
+
+    echo "    { \"case\": \"$1\", \"min_ns\": $2, \"median_ns\": $3, \"mean_ns\": $4 }$separator"
+  done
+
+  echo "  ]"
+  echo "}"
+} > $OUTPUT
@@ -0,0 +1,78 @@
+/*            __ __                                                     *\
+**     __    /_// /  ___            lila bootstrap compiler             **
+**    / /   __ / /  / _ |           (c) 2016, Christian Krause          **
+**   / /__ / // /__/ __ |                                               **
+**  /____//_//____/_/ | |                                               **
+\*                    |/                                                */
+
+#include "ast.hpp"
+#include "util.hpp"
+
+namespace lila {
+  namespace ast {
+
+    string AST::toString(Node node, const SymbolTable &symbols) const {
+      ostringstream oss;
+
+      switch (node.kind()) {
+      case ASTKind::Number:
+        return to_string(numbers[node.index()].value);
+
+      case ASTKind::BinaryExpr: {
+        const BinaryNode &binary = binaries[node.index()];
+        oss << '(' << toString(binary.lhs, symbols) << ' ' << symbols.str(binary.op)
+            << ' ' << toString(binary.rhs, symbols) << ')';
+        break;
+      }
+
+      case ASTKind::Call: {
+        const CallNode &call = calls[node.index()];
+        oss << symbols.str(call.name);
+        if (call.args.size > 0) {
+          vector<string> args;
+          for (auto arg : nodeList(call.args))
+            args.push_back(toString(arg, symbols));
+          oss << '(' << util::mkString(args, ", ") << ')';
+        }
+        break;
+      }
+
+      case ASTKind::Block: {
+        const BlockNode &block = blocks[node.index()];
+        oss << '{' << endl;
+        for (auto item : nodeList(block.body)) {
+          for (int i = 0; i < block.indent; i++)
+            oss << "  ";
+          oss << toString(item, symbols) << endl;
+        }
+        for (int i = 0; i < block.indent - 1; i++)
+          oss << "  ";
+        oss << '}' << endl;
+        break;
+      }
+
+      case ASTKind::Value: {
+        const ValueNode &value = values[node.index()];
+        oss << "val " << symbols.str(value.name) << " = " << toString(value.expr, symbols);
+        break;
+      }
+
+      case ASTKind::Def: {
+        const DefNode &def = defs[node.index()];
+        oss << "def " << symbols.str(def.name);
+        if (def.args.size > 0) {
+          vector<string> names;
+          for (auto arg : symbolList(def.args))
+            names.push_back(symbols.str(arg));
+          oss << '(' << util::mkString(names, ", ") << ')';
+        }
+        oss << " = " << toString(def.body, symbols);
+        break;
+      }
+      }
+
+      return oss.str();
+    }
+
+  }
+}
@@ -8,125 +8,212 @@
 #ifndef LILA_AST_H
 #define LILA_AST_H
 
-#include <memory>
-
-#include <sstream>
+#include <cstdint>
+#include <string>
 #include <vector>
 
-#include "util.hpp"
+#include <llvm/ADT/ArrayRef.h>
+
+#include "symbol.hpp"
 
 using namespace std;
+using namespace lila::symbol;
 
 namespace lila {
   namespace ast {
 
-    class ASTNode {
-    public:
-      virtual string toString() = 0;
-      virtual ~ASTNode() {}
+    // expression kinds come first, see Node::isExpr
+    enum class ASTKind : uint8_t {
+      Number,
+      BinaryExpr,
+      Call,
+      Block,
+      Value,
+      Def
     };
 
-    class ExprAST : public ASTNode {
+    // operators the code generator lowers to instructions, all others are
+    // calls of user defs
+    enum class BuiltinOp : uint8_t {
+      None,
+      Add,
+      Subtract,
+      Multiply
     };
 
-    class NumberExprAST : public ExprAST {
+    // Reference to a node of an AST: the kind in the upper bits selects the
+    // array of the AST the node is stored in, the lower bits are the index
+    // into that array. A default constructed node refers to no node at all.
+    class Node {
+    private:
+      static const unsigned indexBits = 29;
+      uint32_t bits;
 
     public:
-      double value;
-      explicit NumberExprAST(const double &value) : value(value) {}
-      string toString() {
-        return to_string(value);
+      Node() : bits(~0u) {}
+      Node(ASTKind kind, uint32_t index)
+        : bits(((uint32_t) kind << indexBits) | index) {}
+
+      ASTKind kind() const {
+        return (ASTKind) (bits >> indexBits);
+      }
+
+      uint32_t index() const {
+        return bits & ((1u << indexBits) - 1);
       }
-    };
 
-    class BinaryExprAST : public ExprAST {
+      bool isExpr() const {
+        return kind() <= ASTKind::Block;
+      }
 
-    public:
-      string op;
-      unique_ptr<ExprAST> lhs, rhs;
-      explicit BinaryExprAST(const string &op, unique_ptr<ExprAST> lhs, unique_ptr<ExprAST> rhs)
-        : op(op), lhs(move(lhs)), rhs(move(rhs)) {}
-      string toString() {
-        return '(' + lhs->toString() + ' ' + op + ' ' + rhs->toString() + ')';
+      explicit operator bool() const {
+        return bits != ~0u;
       }
     };
 
-    class ValueAST : public ASTNode {
+    // contiguous part of AST::nodeLists or AST::symbolLists
+    class Range {
     public:
-      string name;
-      unique_ptr<ExprAST> expr;
-      explicit ValueAST(const string &name, unique_ptr<ExprAST> expr)
-        : name(name), expr(move(expr)) {}
-      string toString() {
-        return "val " + name + " = " + expr->toString();
-      }
+      uint32_t begin = 0;
+      uint32_t size = 0;
     };
 
-    class DefAST : public ASTNode {
+    // where the resolver found the declaration of a name: frame depth counted
+    // from the top level block and slot within that frame
+    class Binding {
     public:
-      string name;
-      vector<string> args;
-      unique_ptr<ExprAST> body;
-      explicit DefAST(const string &name, const vector<string> &args, unique_ptr<ExprAST> body)
-        : name(name), args(args), body(move(body)) {}
-      string toString() {
-        ostringstream oss;
+      uint32_t depth = 0;
+      uint32_t slot = 0;
+      bool def = false;
+    };
 
-        oss << "def " << name;
+    class NumberNode {
+    public:
+      double value;
+    };
 
-        if (!args.empty()) {
-          oss << '(' << util::mkString(args, ", ") << ')';
-        }
+    class BinaryNode {
+    public:
+      Symbol op;
+      BuiltinOp builtin;
+      Node lhs, rhs;
+      Binding binding; // def of a user operator, set by the resolver
+    };
 
-        oss << " = " << body->toString();
+    class CallNode {
+    public:
+      Symbol name;
+      Range args; // expressions in nodeLists
+      Binding binding; // set by the resolver
+    };
 
-        return oss.str();
-      }
+    class BlockNode {
+    public:
+      Range body; // vals, defs and expressions in nodeLists
+      int indent;
+      uint32_t frameSize = 0; // number of vals and defs, set by the resolver
     };
 
-    class CallAST : public ExprAST {
+    class ValueNode {
     public:
-      string name;
-      unique_ptr<vector<unique_ptr<ExprAST> > > args;
-      explicit CallAST(const string &name, unique_ptr<vector<unique_ptr<ExprAST> > > args)
-        : name(name), args(move(args)) {}
-      string toString() {
-        ostringstream oss;
-        oss << name;
-        if (!args->empty()) {
-          oss << '(';
-          auto size = args->size();
-          for (unsigned i = 0; i < size; i++) {
-            oss << args->at(i)->toString();
-            if (i < (size - 1)) oss << ", ";
-          }
-          oss << ')';
-        }
-        return oss.str();
-      }
+      Symbol name;
+      Node expr;
+      uint32_t slot = 0; // set by the resolver
     };
 
-    class BlockAST : public ExprAST {
+    class DefNode {
     public:
-      unique_ptr<vector<unique_ptr<ASTNode> > > body;
-      int indent;
-      explicit BlockAST(unique_ptr<vector<unique_ptr<ASTNode> > > body, const int i) : body(move(body)) {
-        indent = i;
-      }
-      string toString() {
-        ostringstream oss;
-        oss << '{' << endl;
-        for (auto it = body->begin() ; it != body->end(); ++it) {
-          ASTNode * ast = it->get();
-          for (int i = 0; i < indent; i++)
-            oss << "  ";
-          oss << ast->toString() << endl;
-        }
-        for (int i = 0; i < indent - 1; i++)
-          oss << "  ";
-        oss << '}' << endl;
-        return oss.str();
+      Symbol name;
+      Range args; // argument names in symbolLists
+      Node body;
+      uint32_t slot = 0; // set by the resolver
+    };
+
+    // All nodes of one program. Nodes live in one array per kind and refer
+    // to each other by Node, child lists are ranges of nodeLists and
+    // symbolLists. Nothing is freed before the whole AST is.
+    class AST {
+    public:
+      vector<NumberNode> numbers;
+      vector<BinaryNode> binaries;
+      vector<CallNode> calls;
+      vector<BlockNode> blocks;
+      vector<ValueNode> values;
+      vector<DefNode> defs;
+
+      vector<Node> nodeLists;
+      vector<Symbol> symbolLists;
+
+      Node root; // top level block
+
+      Node addNumber(double value) {
+        numbers.push_back(NumberNode { value });
+        return Node(ASTKind::Number, numbers.size() - 1);
+      }
+
+      Node addBinary(Symbol op, BuiltinOp builtin, Node lhs, Node rhs) {
+        binaries.push_back(BinaryNode { op, builtin, lhs, rhs, Binding() });
+        return Node(ASTKind::BinaryExpr, binaries.size() - 1);
+      }
+
+      Node addCall(Symbol name, Range args) {
+        calls.push_back(CallNode { name, args, Binding() });
+        return Node(ASTKind::Call, calls.size() - 1);
       }
+
+      Node addBlock(Range body, int indent) {
+        blocks.push_back(BlockNode { body, indent });
+        return Node(ASTKind::Block, blocks.size() - 1);
+      }
+
+      Node addValue(Symbol name, Node expr) {
+        values.push_back(ValueNode { name, expr });
+        return Node(ASTKind::Value, values.size() - 1);
+      }
+
+      Node addDef(Symbol name, Range args, Node body) {
+        defs.push_back(DefNode { name, args, body });
+        return Node(ASTKind::Def, defs.size() - 1);
+      }
+
+      Range addNodes(const vector<Node> &nodes) {
+        Range range { (uint32_t) nodeLists.size(), (uint32_t) nodes.size() };
+        nodeLists.insert(nodeLists.end(), nodes.begin(), nodes.end());
+        return range;
+      }
+
+      Range addSymbols(const vector<Symbol> &symbols) {
+        Range range { (uint32_t) symbolLists.size(), (uint32_t) symbols.size() };
+        symbolLists.insert(symbolLists.end(), symbols.begin(), symbols.end());
+        return range;
+      }
+
+      NumberNode &number(Node node) { return numbers[node.index()]; }
+      BinaryNode &binary(Node node) { return binaries[node.index()]; }
+      CallNode &call(Node node) { return calls[node.index()]; }
+      BlockNode &block(Node node) { return blocks[node.index()]; }
+      ValueNode &value(Node node) { return values[node.index()]; }
+      DefNode &def(Node node) { return defs[node.index()]; }
+
+      // only valid until more nodes are added
+      llvm::ArrayRef<Node> nodeList(Range range) const {
+        return llvm::ArrayRef<Node>(nodeLists.data() + range.begin, range.size);
+      }
+
+      llvm::MutableArrayRef<Node> nodeList(Range range) {
+        return llvm::MutableArrayRef<Node>(nodeLists.data() + range.begin, range.size);
+      }
+
+      llvm::ArrayRef<Symbol> symbolList(Range range) const {
+        return llvm::ArrayRef<Symbol>(symbolLists.data() + range.begin, range.size);
+      }
+
+      // number of nodes of all kinds
+      size_t size() const {
+        return numbers.size() + binaries.size() + calls.size() + blocks.size() + values.size() + defs.size();
+      }
+
+      string toString(Node node, const SymbolTable &symbols) const;
     };
 
   }
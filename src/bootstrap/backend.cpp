@@ -0,0 +1,538 @@
+/*            __ __                                                     *\
+**     __    /_// /  ___            lila bootstrap compiler             **
+**    / /   __ / /  / _ |           (c) 2016, Christian Krause          **
+**   / /__ / // /__/ __ |                                               **
+**  /____//_//____/_/ | |                                               **
+\*                    |/                                                */
+
+#include "backend.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/Analysis/TargetLibraryInfo.h>
+#include <llvm/Analysis/TargetTransformInfo.h>
+#include <llvm/Bitcode/ReaderWriter.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/MC/SubtargetFeature.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Program.h>
+#include <llvm/Support/TargetRegistry.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/ToolOutputFile.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetSubtargetInfo.h>
+#include <llvm/Transforms/IPO.h>
+#include <llvm/Transforms/IPO/PassManagerBuilder.h>
+#include <llvm/Transforms/Utils/SplitModule.h>
+
+using namespace std;
+
+namespace lila {
+  namespace backend {
+
+    bool parseOptLevel(const char *arg, OptLevel &level) {
+      if (strlen(arg) != 1)
+        return false;
+
+      switch (arg[0]) {
+      case '0': case '1': case '2': case '3':
+        level.speed = arg[0] - '0';
+        level.size = 0;
+        return true;
+      case 's':
+        level.speed = 2;
+        level.size = 1;
+        return true;
+      case 'z':
+        level.speed = 2;
+        level.size = 2;
+        return true;
+      default:
+        return false;
+      }
+    }
+
+    static llvm::CodeGenOpt::Level codeGenOptLevel(const OptLevel &level) {
+      if (level.size > 0)
+        return llvm::CodeGenOpt::Default;
+
+      switch (level.speed) {
+      case 0:  return llvm::CodeGenOpt::None;
+      case 1:  return llvm::CodeGenOpt::Less;
+      case 2:  return llvm::CodeGenOpt::Default;
+      default: return llvm::CodeGenOpt::Aggressive;
+      }
+    }
+
+    string hostTriple() {
+      return llvm::sys::getDefaultTargetTriple();
+    }
+
+    string hostCPU() {
+      return llvm::sys::getHostCPUName();
+    }
+
+    string hostFeatures() {
+      llvm::SubtargetFeatures Features;
+      llvm::StringMap<bool> HostFeatures;
+      if (llvm::sys::getHostCPUFeatures(HostFeatures))
+        for (auto &F : HostFeatures)
+          Features.AddFeature(F.first(), F.second);
+      return Features.getString();
+    }
+
+    static once_flag targetsInitialized;
+
+    void initializeTargets() {
+      call_once(targetsInitialized, []() {
+        // lilac only compiles for the host, the other targets would just add
+        // to the startup time
+        llvm::InitializeNativeTarget();
+        llvm::InitializeNativeTargetAsmPrinter();
+        llvm::InitializeNativeTargetAsmParser();
+
+        llvm::PassRegistry *Registry = llvm::PassRegistry::getPassRegistry();
+        llvm::initializeCore(*Registry);
+        llvm::initializeCodeGen(*Registry);
+        llvm::initializeLoopStrengthReducePass(*Registry);
+        llvm::initializeLowerIntrinsicsPass(*Registry);
+        llvm::initializeUnreachableBlockElimPass(*Registry);
+      });
+    }
+
+    unique_ptr<llvm::TargetMachine> createTargetMachine(const OptLevel &level, string &error,
+                                                        bool jit) {
+      initializeTargets();
+
+      llvm::Triple TheTriple(hostTriple());
+
+      const llvm::Target *TheTarget =
+        llvm::TargetRegistry::lookupTarget(TheTriple.getTriple(), error);
+
+      if (!TheTarget)
+        return nullptr;
+
+      std::string CPUStr = hostCPU();
+      std::string FeaturesStr = hostFeatures();
+
+      llvm::TargetOptions Options;
+
+      return unique_ptr<llvm::TargetMachine>(
+        TheTarget->createTargetMachine(TheTriple.getTriple(),
+                                       CPUStr,
+                                       FeaturesStr,
+                                       Options,
+                                       llvm::Reloc::Default,
+                                       jit ? llvm::CodeModel::JITDefault : llvm::CodeModel::Default,
+                                       codeGenOptLevel(level)));
+    }
+
+    void prepareModule(llvm::Module &module, llvm::TargetMachine &target, const OptLevel &level) {
+      module.setTargetTriple(target.getTargetTriple().str());
+
+      if (const llvm::DataLayout *DL = target.getDataLayout())
+        module.setDataLayout(*DL);
+
+      std::string CPUStr = target.getTargetCPU();
+      std::string FeaturesStr = target.getTargetFeatureString();
+
+      // add features to functions of module
+      for (auto &F : module) {
+        auto &Ctx = F.getContext();
+        llvm::AttributeSet Attrs = F.getAttributes(), NewAttrs;
+
+        if (!CPUStr.empty())
+          NewAttrs = NewAttrs.addAttribute(Ctx, llvm::AttributeSet::FunctionIndex,
+                                           "target-cpu", CPUStr);
+
+        if (!FeaturesStr.empty())
+          NewAttrs = NewAttrs.addAttribute(Ctx, llvm::AttributeSet::FunctionIndex,
+                                           "target-features", FeaturesStr);
+
+        NewAttrs = Attrs.addAttributes(Ctx, llvm::AttributeSet::FunctionIndex, NewAttrs);
+        F.setAttributes(NewAttrs);
+
+        if (F.isDeclaration())
+          continue;
+
+        // as clang does, -O0 keeps every function as written
+        if (level.speed == 0) {
+          F.addFnAttr(llvm::Attribute::OptimizeNone);
+          F.addFnAttr(llvm::Attribute::NoInline);
+        }
+
+        if (level.size >= 1)
+          F.addFnAttr(llvm::Attribute::OptimizeForSize);
+
+        if (level.size >= 2)
+          F.addFnAttr(llvm::Attribute::MinSize);
+      }
+    }
+
+    void optimizeModule(llvm::Module &module, llvm::TargetMachine &target, const OptLevel &level,
+                        trace::Trace *trace) {
+      llvm::Triple TheTriple(module.getTargetTriple());
+
+      // the builder owns library info and inliner
+      llvm::PassManagerBuilder Builder;
+      Builder.OptLevel = level.speed;
+      Builder.SizeLevel = level.size;
+      Builder.LibraryInfo = new llvm::TargetLibraryInfoImpl(TheTriple);
+
+      if (level.speed > 1)
+        Builder.Inliner = llvm::createFunctionInliningPass(level.speed, level.size);
+      else
+        Builder.Inliner = llvm::createAlwaysInlinerPass();
+
+      Builder.LoopVectorize = level.speed > 1 && level.size < 2;
+      Builder.SLPVectorize = level.speed > 1 && level.size < 2;
+      Builder.DisableUnrollLoops = level.speed == 0;
+
+      llvm::legacy::FunctionPassManager FPM(&module);
+      FPM.add(llvm::createTargetTransformInfoWrapperPass(target.getTargetIRAnalysis()));
+
+      llvm::legacy::PassManager MPM;
+      MPM.add(llvm::createTargetTransformInfoWrapperPass(target.getTargetIRAnalysis()));
+
+      Builder.populateFunctionPassManager(FPM);
+      Builder.populateModulePassManager(MPM);
+
+      FPM.doInitialization();
+      for (auto &F : module) {
+        trace::Trace::Scope scope(trace, "optimize function", F.getName());
+        FPM.run(F);
+      }
+      FPM.doFinalization();
+
+      trace::Trace::Scope scope(trace, "optimize module");
+      MPM.run(module);
+    }
+
+    // an output may be a link to an object of a cache, which must not be
+    // overwritten in place
+    static void unlinkOutput(const char *output) {
+      if (llvm::sys::fs::is_regular_file(output))
+        llvm::sys::fs::remove(output);
+    }
+
+    bool parseFileType(const char *arg, FileType &type) {
+      llvm::StringRef name(arg);
+
+      if (name == "obj")
+        type = FileType::Object;
+      else if (name == "asm")
+        type = FileType::Assembly;
+      else if (name == "llvm")
+        type = FileType::IR;
+      else if (name == "bc")
+        type = FileType::Bitcode;
+      else
+        return false;
+
+      return true;
+    }
+
+    const char *fileExtension(FileType type) {
+      switch (type) {
+      case FileType::Object:   return "o";
+      case FileType::Assembly: return "s";
+      case FileType::IR:       return "ll";
+      case FileType::Bitcode:  return "bc";
+      }
+
+      return "o";
+    }
+
+    bool emitFile(llvm::Module &module, llvm::TargetMachine &target, FileType type,
+                  const char *output, string &error) {
+      unlinkOutput(output);
+
+      bool text = type == FileType::Assembly || type == FileType::IR;
+
+      std::error_code EC;
+      auto Out = llvm::make_unique<llvm::tool_output_file>(output, EC,
+                                                           text ? llvm::sys::fs::F_Text : llvm::sys::fs::F_None);
+
+      if (EC) {
+        error = EC.message();
+        return false;
+      }
+
+      if (type == FileType::IR) {
+        module.print(Out->os(), nullptr);
+        Out->keep();
+        return true;
+      }
+
+      if (type == FileType::Bitcode) {
+        llvm::WriteBitcodeToFile(&module, Out->os());
+        Out->keep();
+        return true;
+      }
+
+      llvm::Triple TheTriple(module.getTargetTriple());
+
+      llvm::legacy::PassManager PM;
+      llvm::TargetLibraryInfoImpl TLII(TheTriple);
+      PM.add(new llvm::TargetLibraryInfoWrapperPass(TLII));
+
+      llvm::raw_pwrite_stream *OS = &Out->os();
+
+      auto CodeGenFileType = type == FileType::Assembly
+        ? llvm::TargetMachine::CGFT_AssemblyFile
+        : llvm::TargetMachine::CGFT_ObjectFile;
+
+      if (target.addPassesToEmitFile(PM, *OS, CodeGenFileType)) {
+        error = "target does not support generation of this file type";
+        return false;
+      }
+
+      PM.run(module);
+
+      Out->keep();
+
+      return true;
+    }
+
+    // partitions are compiled in parallel, but each costs a context, a target
+    // machine and an object to link
+    static const unsigned maxPartitions = 32;
+
+    // with a cache, the partition of a definition must not change as the
+    // program grows
+    static const unsigned cachedPartitions = 64;
+
+    // inlining needs the callees, which end up in other partitions
+    static void inlineModule(llvm::Module &module, llvm::TargetMachine &target, const OptLevel &level) {
+      if (level.speed < 2)
+        return;
+
+      llvm::legacy::PassManager MPM;
+      MPM.add(llvm::createTargetTransformInfoWrapperPass(target.getTargetIRAnalysis()));
+      MPM.add(new llvm::TargetLibraryInfoWrapperPass(llvm::Triple(module.getTargetTriple())));
+      MPM.add(llvm::createFunctionInliningPass(level.speed, level.size));
+      MPM.run(module);
+    }
+
+    static bool hasDefinitions(const llvm::Module &module) {
+      for (auto &function : module)
+        if (!function.isDeclaration())
+          return true;
+
+      for (auto &global : module.globals())
+        if (!global.isDeclaration())
+          return true;
+
+      return false;
+    }
+
+    // a partition declares every global of the module, the unused ones would
+    // change its bitcode whenever a definition is added elsewhere
+    static void removeUnusedDeclarations(llvm::Module &module) {
+      for (auto it = module.begin(); it != module.end(); ) {
+        llvm::Function &function = *it++;
+        if (function.isDeclaration() && function.use_empty())
+          function.eraseFromParent();
+      }
+
+      for (auto it = module.global_begin(); it != module.global_end(); ) {
+        llvm::GlobalVariable &global = *it++;
+        if (global.isDeclaration() && global.use_empty())
+          global.eraseFromParent();
+      }
+    }
+
+    // links the objects into one relocatable object
+    static bool linkObjects(const vector<string> &objects, const char *output, string &error) {
+      auto ld = llvm::sys::findProgramByName("ld");
+
+      if (!ld) {
+        error = "ld not found: " + ld.getError().message();
+        return false;
+      }
+
+      // ld would write STDOUT to a file called "-", so it links to a
+      // temporary file, which is copied to STDOUT
+      bool toStdout = strcmp(output, "-") == 0;
+      llvm::SmallString<128> linked(output);
+
+      if (toStdout) {
+        if (std::error_code EC = llvm::sys::fs::createTemporaryFile("lilac", "o", linked)) {
+          error = EC.message();
+          return false;
+        }
+      } else {
+        unlinkOutput(output);
+      }
+
+      vector<const char *> args = { "ld", "-r", "-o", linked.c_str() };
+      for (auto &object : objects)
+        args.push_back(object.c_str());
+      args.push_back(nullptr);
+
+      bool success = llvm::sys::ExecuteAndWait(*ld, args.data(), nullptr, nullptr, 0, 0, &error) == 0;
+
+      if (!success && error.empty())
+        error = "ld failed";
+
+      if (success && toStdout) {
+        auto buffer = llvm::MemoryBuffer::getFile(linked);
+
+        if (buffer) {
+          llvm::outs() << (*buffer)->getBuffer();
+          llvm::outs().flush();
+        } else {
+          error = buffer.getError().message();
+          success = false;
+        }
+      }
+
+      if (toStdout)
+        llvm::sys::fs::remove(linked);
+
+      return success;
+    }
+
+    bool emitObjectParallel(unique_ptr<llvm::Module> module, llvm::TargetMachine &target,
+                            const OptLevel &level, unsigned jobs, const char *output, string &error,
+                            cache::ObjectCache *cache, llvm::ArrayRef<string> config,
+                            trace::Trace *trace) {
+      trace::Trace::Scope inlining(trace, "inline module");
+      inlineModule(*module, target, level);
+      inlining.end();
+
+      unsigned definitions = 0;
+      for (auto &function : *module)
+        if (!function.isDeclaration())
+          definitions++;
+
+      unsigned count = cache ? cachedPartitions : std::max(1u, std::min(definitions, maxPartitions));
+      string name = module->getModuleIdentifier();
+
+      // partitions share the context of the module, so they go to the threads
+      // as bitcode
+      vector<string> partitions;
+
+      llvm::SplitModule(move(module), count, [&](unique_ptr<llvm::Module> part) {
+        if (!hasDefinitions(*part))
+          return;
+
+        removeUnusedDeclarations(*part);
+
+        partitions.push_back(string());
+        llvm::raw_string_ostream stream(partitions.back());
+        llvm::WriteBitcodeToFile(part.get(), stream);
+      });
+
+      vector<string> objects(partitions.size());
+      vector<string> errors(partitions.size());
+
+      if (objects.size() == 1) {
+        objects[0] = output;
+      } else {
+        for (auto &object : objects) {
+          llvm::SmallString<128> path;
+
+          if (std::error_code EC = llvm::sys::fs::createTemporaryFile("lilac", "o", path)) {
+            error = EC.message();
+            for (auto &created : objects)
+              if (!created.empty())
+                llvm::sys::fs::remove(created);
+            return false;
+          }
+
+          object = path.str();
+        }
+      }
+
+      // partitions compiled before, with the same definitions and callees
+      vector<string> keys(partitions.size());
+      vector<bool> cached(partitions.size());
+
+      if (cache)
+        for (unsigned i = 0; i < partitions.size(); i++) {
+          keys[i] = cache::ObjectCache::key(partitions[i], config);
+          cached[i] = cache->fetch(keys[i], objects[i]);
+        }
+
+      std::atomic<unsigned> next(0);
+
+      auto compile = [&]() {
+        string targetError;
+        unique_ptr<llvm::TargetMachine> partTarget;
+
+        for (unsigned i = next++; i < partitions.size(); i = next++) {
+          if (cached[i])
+            continue;
+
+          string index = to_string(i);
+
+          // not before the first part of this worker that is not cached
+          if (!partTarget && targetError.empty())
+            partTarget = createTargetMachine(level, targetError);
+
+          if (!partTarget) {
+            errors[i] = targetError;
+            continue;
+          }
+
+          llvm::LLVMContext context;
+          auto part = llvm::parseBitcodeFile(llvm::MemoryBufferRef(partitions[i], name), context);
+
+          if (!part) {
+            errors[i] = part.getError().message();
+            continue;
+          }
+
+          {
+            trace::Trace::Scope optimizing(trace, "optimize part", index);
+            optimizeModule(**part, *partTarget, level, trace);
+          }
+
+          trace::Trace::Scope emitting(trace, "emit part", index);
+
+          if (emitFile(**part, *partTarget, FileType::Object, objects[i].c_str(), errors[i]) && cache)
+            cache->store(keys[i], objects[i], false);
+        }
+      };
+
+      vector<std::thread> threads;
+      unsigned threadCount = std::min<size_t>(std::max(1u, jobs), partitions.size());
+
+      for (unsigned i = 1; i < threadCount; i++)
+        threads.emplace_back(compile);
+
+      compile();
+
+      for (auto &thread : threads)
+        thread.join();
+
+      bool compiled = true;
+      for (auto &partError : errors)
+        if (!partError.empty()) {
+          error = partError;
+          compiled = false;
+          break;
+        }
+
+      bool linked = compiled && (objects.size() == 1 || linkObjects(objects, output, error));
+
+      if (cache)
+        cache->evict();
+
+      if (objects.size() > 1)
+        for (auto &object : objects)
+          llvm::sys::fs::remove(object);
+
+      return linked;
+    }
+
+  }
+}
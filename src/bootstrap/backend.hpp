@@ -0,0 +1,92 @@
+/*            __ __                                                     *\
+**     __    /_// /  ___            lila bootstrap compiler             **
+**    / /   __ / /  / _ |           (c) 2016, Christian Krause          **
+**   / /__ / // /__/ __ |                                               **
+**  /____//_//____/_/ | |                                               **
+\*                    |/                                                */
+
+#ifndef LILA_BACKEND_H
+#define LILA_BACKEND_H
+
+#include <memory>
+#include <string>
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Target/TargetMachine.h>
+
+#include "cache.hpp"
+#include "trace.hpp"
+
+namespace lila {
+  namespace backend {
+
+    // -O0 .. -O3, -Os and -Oz as in clang
+    class OptLevel {
+    public:
+      unsigned speed = 2; // 0 to 3
+      unsigned size = 0;  // 1 for -Os, 2 for -Oz
+    };
+
+    // parses the argument of -O, i.e. one of 0, 1, 2, 3, s, z
+    bool parseOptLevel(const char *arg, OptLevel &level);
+
+    // native object, native assembly, textual LLVM IR or LLVM bitcode, the
+    // latter two for link time optimization with the code of other languages
+    enum class FileType { Object, Assembly, IR, Bitcode };
+
+    // parses the argument of --emit, i.e. one of obj, asm, llvm, bc
+    bool parseFileType(const char *arg, FileType &type);
+
+    // o, s, ll or bc
+    const char *fileExtension(FileType type);
+
+    // triple, CPU name and feature string of the host, which lilac compiles
+    // for
+    std::string hostTriple();
+    std::string hostCPU();
+    std::string hostFeatures();
+
+    // registers the host target and the passes the backend needs, once;
+    // createTargetMachine calls it, so inputs that fail before the backend or
+    // are found in the cache never pay for it
+    void initializeTargets();
+
+    // target machine for the native CPU and its features, nullptr and error
+    // set if the host target is not available, jit selects the code model
+    // for code compiled in memory
+    std::unique_ptr<llvm::TargetMachine> createTargetMachine(const OptLevel &level, std::string &error,
+                                                        bool jit = false);
+
+    // sets data layout and triple of the module and the CPU, feature and
+    // optimization attributes of its functions
+    void prepareModule(llvm::Module &module, llvm::TargetMachine &target, const OptLevel &level);
+
+    // runs the standard function and module optimization pipelines, the
+    // function pipeline is traced for each function
+    void optimizeModule(llvm::Module &module, llvm::TargetMachine &target, const OptLevel &level,
+                        trace::Trace *trace = nullptr);
+
+    // writes the optimized module as a file of the type to output
+    bool emitFile(llvm::Module &module, llvm::TargetMachine &target, FileType type,
+                  const char *output, std::string &error);
+
+    // Optimizes and emits a prepared module on up to jobs threads: after
+    // inlining across the whole module, its definitions are split into
+    // partitions, each optimized and compiled in its own LLVMContext, and the
+    // partial objects are linked into one relocatable object with ld -r. The
+    // partitions only depend on the module, so the object is the same for
+    // any number of jobs. With a cache, partitions compiled before with the
+    // same definitions and callees are taken from it instead, config as for
+    // ObjectCache::key. With a trace, the inlining and each partition compiled
+    // are recorded, the functions of a partition as for optimizeModule.
+    bool emitObjectParallel(std::unique_ptr<llvm::Module> module, llvm::TargetMachine &target,
+                            const OptLevel &level, unsigned jobs, const char *output, std::string &error,
+                            cache::ObjectCache *cache = nullptr,
+                            llvm::ArrayRef<std::string> config = llvm::None,
+                            trace::Trace *trace = nullptr);
+
+  }
+}
+
+#endif
@@ -0,0 +1,170 @@
+/*            __ __                                                     *\
+**     __    /_// /  ___            lila bootstrap compiler             **
+**    / /   __ / /  / _ |           (c) 2016, Christian Krause          **
+**   / /__ / // /__/ __ |                                               **
+**  /____//_//____/_/ | |                                               **
+\*                    |/                                                */
+
+#include "cache.hpp"
+
+#include <utime.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MD5.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/TimeValue.h>
+#include <llvm/Support/raw_ostream.h>
+
+using namespace std;
+
+namespace lila {
+  namespace cache {
+
+    // contents of file from to file to, "-" is STDOUT
+    static bool copyFile(const string &from, const string &to) {
+      auto buffer = llvm::MemoryBuffer::getFile(from);
+
+      if (!buffer)
+        return false;
+
+      std::error_code EC;
+      llvm::raw_fd_ostream out(to, EC, llvm::sys::fs::F_None);
+
+      if (EC)
+        return false;
+
+      out << (*buffer)->getBuffer();
+      out.close();
+
+      bool failed = out.has_error();
+      out.clear_error();
+      return !failed;
+    }
+
+    ObjectCache::ObjectCache(const string &dir, uint64_t maxSize)
+      : dir(dir), maxSize(maxSize) {
+      llvm::sys::fs::create_directories(dir);
+    }
+
+    string ObjectCache::path(const string &key) const {
+      return dir + "/" + key + ".o";
+    }
+
+    string ObjectCache::key(llvm::StringRef source, llvm::ArrayRef<string> config) {
+      llvm::MD5 hash;
+
+      // with the lengths, no two different configurations hash the same bytes
+      for (auto &item : config) {
+        hash.update(to_string(item.size()));
+        hash.update(":");
+        hash.update(item);
+      }
+
+      hash.update(to_string(source.size()));
+      hash.update(":");
+      hash.update(source);
+
+      llvm::MD5::MD5Result result;
+      hash.final(result);
+
+      llvm::SmallString<32> hex;
+      llvm::MD5::stringifyResult(result, hex);
+      return string(hex.str());
+    }
+
+    bool ObjectCache::fetch(const string &key, const string &output) {
+      string object = path(key);
+
+      if (!llvm::sys::fs::exists(object))
+        return false;
+
+      bool linked = false;
+
+      // a link is free, but it must not replace e.g. /dev/null
+      if (output != "-" &&
+          (!llvm::sys::fs::exists(output) || llvm::sys::fs::is_regular_file(output))) {
+        llvm::sys::fs::remove(output);
+        linked = !llvm::sys::fs::create_hard_link(object, output);
+      }
+
+      // the object may have been evicted meanwhile
+      if (!linked && !copyFile(object, output))
+        return false;
+
+      // most recently used
+      utime(object.c_str(), nullptr);
+
+      return true;
+    }
+
+    void ObjectCache::store(const string &key, const string &object, bool evictAfter) {
+      int fd;
+      llvm::SmallString<128> temp;
+
+      if (llvm::sys::fs::createUniqueFile(dir + "/%%%%%%%%%%%%%%%%.tmp", fd, temp))
+        return;
+
+      auto buffer = llvm::MemoryBuffer::getFile(object);
+      llvm::raw_fd_ostream out(fd, true);
+
+      if (buffer)
+        out << (*buffer)->getBuffer();
+
+      out.close();
+
+      bool failed = !buffer || out.has_error();
+      out.clear_error();
+
+      // other compilers see all of the object or none of it
+      if (failed || llvm::sys::fs::rename(temp, path(key))) {
+        llvm::sys::fs::remove(temp);
+        return;
+      }
+
+      if (evictAfter)
+        evict();
+    }
+
+    void ObjectCache::evict() {
+      struct Entry {
+        llvm::sys::TimeValue used;
+        uint64_t size;
+        string path;
+      };
+
+      vector<Entry> entries;
+      uint64_t size = 0;
+
+      std::error_code EC;
+      for (llvm::sys::fs::directory_iterator it(dir, EC), end; it != end && !EC; it.increment(EC)) {
+        llvm::sys::fs::file_status status;
+
+        if (!llvm::StringRef(it->path()).endswith(".o") || it->status(status))
+          continue;
+
+        entries.push_back(Entry { status.getLastModificationTime(), status.getSize(), it->path() });
+        size += status.getSize();
+      }
+
+      if (size <= maxSize)
+        return;
+
+      sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return a.used < b.used;
+      });
+
+      for (auto &entry : entries) {
+        if (size <= maxSize)
+          break;
+
+        if (!llvm::sys::fs::remove(entry.path))
+          size -= entry.size;
+      }
+    }
+
+  }
+}
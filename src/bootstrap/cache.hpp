@@ -0,0 +1,53 @@
+/*            __ __                                                     *\
+**     __    /_// /  ___            lila bootstrap compiler             **
+**    / /   __ / /  / _ |           (c) 2016, Christian Krause          **
+**   / /__ / // /__/ __ |                                               **
+**  /____//_//____/_/ | |                                               **
+\*                    |/                                                */
+
+#ifndef LILA_CACHE_H
+#define LILA_CACHE_H
+
+#include <cstdint>
+#include <string>
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringRef.h>
+
+namespace lila {
+  namespace cache {
+
+    // Object files in a directory, named by a hash of everything they were
+    // compiled from. Objects are written to a temporary file and renamed, so
+    // concurrent compilers never see half of one. The least recently used
+    // objects are removed when the directory grows beyond its size limit.
+    // Failures of the cache are never errors, they only make it miss.
+    class ObjectCache {
+    private:
+      const std::string dir;
+      const uint64_t maxSize;
+
+      std::string path(const std::string &key) const;
+
+    public:
+      ObjectCache(const std::string &dir, uint64_t maxSize);
+
+      // hash of the source and the configuration, e.g. compiler version,
+      // target triple, CPU, features and optimization level
+      static std::string key(llvm::StringRef source, llvm::ArrayRef<std::string> config);
+
+      // links or copies the cached object to output, false on a miss
+      bool fetch(const std::string &key, const std::string &output);
+
+      // adds a copy of the object file at path, evicting the least recently
+      // used objects unless the caller stores more and evicts itself
+      void store(const std::string &key, const std::string &object, bool evictAfter = true);
+
+      // removes the least recently used objects until the cache fits
+      void evict();
+    };
+
+  }
+}
+
+#endif
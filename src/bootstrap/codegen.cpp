@@ -7,97 +7,97 @@
 
 #include "codegen.hpp"
 
+#include <algorithm>
+
 #include <llvm/Support/raw_ostream.h>
 
 namespace lila {
   namespace codegen {
 
-    llvm::Value* CodeGen::generateCodeNumber(NumberExprAST *ast) {
-      return llvm::ConstantFP::get(context, llvm::APFloat(ast->value));
+    llvm::Value* CodeGen::generateCodeNumber(const NumberNode &number) {
+      return llvm::ConstantFP::get(context, llvm::APFloat(number.value));
     }
 
-    llvm::Value* CodeGen::generateCodeExpr(ExprAST *ast) {
-      if (auto x = dynamic_cast<NumberExprAST*>(ast)) {
-        return generateCodeNumber(x);
-      } else if (auto x = dynamic_cast<CallAST*>(ast)) {
-        return generateCodeCall(x);
-      } else if (auto x = dynamic_cast<BinaryExprAST*>(ast)) {
-        return generateCodeBinOp(x);
-      } else if (auto x = dynamic_cast<BlockAST*>(ast)) {
-        return generateCodeBlock(x);
-      } else {
+    llvm::Value* CodeGen::generateCodeExpr(Node node) {
+      switch (node.kind()) {
+      case ASTKind::Number:
+        return generateCodeNumber(ast->number(node));
+      case ASTKind::Call:
+        return generateCodeCall(ast->call(node));
+      case ASTKind::BinaryExpr:
+        return generateCodeBinOp(ast->binary(node));
+      case ASTKind::Block:
+        return generateCodeBlock(ast->block(node));
+      default:
         error = "can't handle expression ast";
         return nullptr;
       }
     }
 
-    llvm::Value* CodeGen::generateCodeBlock(BlockAST *ast) {
+    llvm::Value* CodeGen::generateCodeBlock(const BlockNode &block) {
       llvm::BasicBlock * prevInsertPoint = Builder.GetInsertBlock();
       llvm::Value * lastExpr;
 
-      for (auto it = ast->body->begin() ; it != ast->body->end(); ++it) {
-        ASTNode * node = it->get();
+      frames.push_back(vector<llvm::Value*>(block.frameSize));
 
-        if (auto x = dynamic_cast<ValueAST*>(node)) {
-          auto code = generateCodeValue(x);
-          if (!code) return nullptr;
+      for (auto node : ast->nodeList(block.body)) {
+        switch (node.kind()) {
+        case ASTKind::Value:
+          if (!generateCodeValue(ast->value(node))) return nullptr;
+          break;
 
-        } else if (auto x = dynamic_cast<DefAST*>(node)) {
-          generateCodeDef(x);
+        case ASTKind::Def:
+          if (!generateCodeDef(ast->def(node))) return nullptr;
           Builder.SetInsertPoint(prevInsertPoint);
+          break;
 
-        } else if (auto x = dynamic_cast<NumberExprAST*>(node)) {
-          auto code = generateCodeNumber(x);
-          if (!code) return nullptr;
-          lastExpr = code;
-
-        } else if (auto x = dynamic_cast<BinaryExprAST*>(node)) {
-          auto code = generateCodeBinOp(x);
-          if (!code) return nullptr;
-          lastExpr = code;
-
-        } else if (auto x = dynamic_cast<CallAST*>(node)) {
-          auto code = generateCodeCall(x);
-          if (!code) return nullptr;
-          lastExpr = code;
-
-        } else {
-          error = "can't handle ast";
-          return nullptr;
+        default:
+          lastExpr = generateCodeExpr(node);
+          if (!lastExpr) return nullptr;
+          break;
         }
       }
 
+      frames.pop_back();
+
       return lastExpr;
     }
 
-    llvm::Value* CodeGen::generateCodeBinOp(BinaryExprAST *ast) {
-      llvm::Value *L = generateCodeExpr(ast->lhs.get());
-      llvm::Value *R = generateCodeExpr(ast->rhs.get());
+    llvm::Value* CodeGen::generateCodeBinOp(const BinaryNode &binary) {
+      llvm::Value *L = generateCodeExpr(binary.lhs);
+      llvm::Value *R = generateCodeExpr(binary.rhs);
 
       if (!L || !R)
         return nullptr;
 
-      string op = ast->op;
-
-      if (op == "+") {
+      switch (binary.builtin) {
+      case BuiltinOp::Add:
         return Builder.CreateFAdd(L, R, "addtmp");
-      } else if (op == "-") {
+      case BuiltinOp::Subtract:
         return Builder.CreateFSub(L, R, "subtmp");
-      } else if (op == "*") {
+      case BuiltinOp::Multiply:
         return Builder.CreateFMul(L, R, "multmp");
-      } else {
-        error = "unknown operator, don't know what to do with it";
-      }
+      default: {
+        // user operator, call its def
+        llvm::Value * value = frames[binary.binding.depth][binary.binding.slot];
+
+        if (!value) {
+          error = symbols.str(binary.op) + " not found";
+          return nullptr;
+        }
 
-      return nullptr;
+        llvm::Value * args[] = { L, R };
+        return Builder.CreateCall(llvm::cast<llvm::Function>(importValue(value)), args,
+                                  "call" + symbols.str(binary.op));
+      }
+      }
     }
 
-    llvm::Function * CodeGen::generateCodeDef(DefAST *ast) {
-      // add def name to scope
-      addScope(ast->name);
+    llvm::Function * CodeGen::generateCodeDef(const DefNode &def) {
+      auto argnames = ast->symbolList(def.args);
 
       // argument types
-      vector<llvm::Type*> args(ast->args.size(), llvm::Type::getDoubleTy(context));
+      vector<llvm::Type*> args(argnames.size(), llvm::Type::getDoubleTy(context));
 
       // return type
       auto retType = llvm::Type::getDoubleTy(context);
@@ -106,30 +106,40 @@ namespace lila {
       llvm::FunctionType *funcType = llvm::FunctionType::get(retType, args, false);
 
       llvm::Function * func =
-        llvm::Function::Create(funcType, llvm::Function::ExternalLinkage, ast->name, module.get());
+        llvm::Function::Create(funcType, llvm::Function::ExternalLinkage,
+                               llvm::Twine(prefix) + scope + symbols.name(def.name), module.get());
+
+      string outerScope = scope;
+      scope += symbols.str(def.name) + ".";
+
+      // the def's frame holds its arguments
+      frames.push_back(vector<llvm::Value*>(argnames.size()));
 
       unsigned i = 0;
-      for (auto funcarg = func->arg_begin(); i != ast->args.size(); ++funcarg, ++i) {
-        funcarg->setName(ast->args[i]);
-        addScopedValue(ast->args[i], funcarg);
+      for (auto funcarg = func->arg_begin(); i != argnames.size(); ++funcarg, ++i) {
+        funcarg->setName(symbols.name(argnames[i]));
+        frames.back()[i] = funcarg;
       }
 
       llvm::BasicBlock *block = llvm::BasicBlock::Create(context, "entry", func);
       Builder.SetInsertPoint(block);
 
-      if (llvm::Value * result = generateCodeExpr(ast->body.get())) {
+      llvm::Value * result = generateCodeExpr(def.body);
+      scope = outerScope;
+
+      if (result) {
         Builder.CreateRet(result);
 
         string verifyS;
         llvm::raw_string_ostream verifyE(verifyS);
         if (verifyFunction(*func, &verifyE)) {
           func->eraseFromParent();
-          error = "something wrong with function \"" + ast->name + "\": " + verifyS;
+          error = "something wrong with function \"" + symbols.str(def.name) + "\": " + verifyS;
           return nullptr;
         }
 
-        // remove the def name scope
-        removeScope();
+        frames.pop_back();
+        frames.back()[def.slot] = func;
         return func;
       } else {
         func->eraseFromParent();
@@ -138,46 +148,88 @@ namespace lila {
       }
     }
 
-    llvm::Value * CodeGen::generateCodeValue(ValueAST *ast) {
-      addScope(ast->name);
-      llvm::Value * exprCode = generateCodeExpr(ast->expr.get());
-      removeScope();
+    llvm::Value * CodeGen::generateCodeValue(const ValueNode &value) {
+      string outerScope = scope;
+      scope += symbols.str(value.name) + ".";
+
+      llvm::Value * exprCode = generateCodeExpr(value.expr);
+      scope = outerScope;
+
+      if (!exprCode) return nullptr;
 
-      addScopedValue(ast->name, exprCode);
+      frames.back()[value.slot] = exprCode;
 
       return exprCode;
     }
 
-    llvm::Value * CodeGen::generateCodeCall(CallAST *ast) {
-      if (auto value = findScopedValue(ast->name)) {
-        return value;
-      } else if (auto function = module->getFunction(ast->name)) {
-        if (function->arg_size() != ast->args->size()) {
+    llvm::Value * CodeGen::generateCodeCall(const CallNode &call) {
+      llvm::Value * value = frames[call.binding.depth][call.binding.slot];
+
+      if (!value) {
+        error = symbols.str(call.name) + " not found";
+        return nullptr;
+      } else if (!call.binding.def) {
+        return importValue(value);
+      } else {
+        auto function = llvm::cast<llvm::Function>(importValue(value));
+
+        auto callargs = ast->nodeList(call.args);
+
+        if (function->arg_size() != callargs.size()) {
           error = "incorrect number of arguments";
           return nullptr;
         }
 
         vector<llvm::Value*> args;
-        for (unsigned i = 0, e = ast->args->size(); i != e; ++i) {
-          ExprAST * expr = ast->args->at(i).get();
-          llvm::Value * value = generateCodeExpr(expr);
+        for (auto arg : callargs) {
+          llvm::Value * value = generateCodeExpr(arg);
           if (!value) return nullptr;
           args.push_back(value);
         }
 
-        return Builder.CreateCall(function, args, "call" + ast->name);
-      } else {
-        error = ast->name + " not found";
-        return nullptr;
+        return Builder.CreateCall(function, args, "call" + symbols.str(call.name));
       }
     }
 
-    bool CodeGen::wrapTopLevelBlockInMain(BlockAST *ast) {
-      // add main to scope
-      addScope("main");
+    llvm::Value * CodeGen::importValue(llvm::Value *value) {
+      if (auto function = llvm::dyn_cast<llvm::Function>(value)) {
+        if (function->getParent() == module.get())
+          return function;
+
+        return module->getOrInsertFunction(function->getName(), function->getFunctionType());
+      }
+
+      // vals of an interactive session that are not constant
+      if (auto global = llvm::dyn_cast<llvm::GlobalVariable>(value)) {
+        llvm::Constant * local = global;
 
-      vector<unique_ptr<ASTNode> > * body = ast->body.get();
+        if (global->getParent() != module.get())
+          local = module->getOrInsertGlobal(global->getName(), Builder.getDoubleTy());
 
+        return Builder.CreateLoad(local, global->getName());
+      }
+
+      return value;
+    }
+
+    void CodeGen::generateCodePrint(llvm::Value *value) {
+      llvm::Value *fmt = Builder.CreateGlobalStringPtr("%lg\n");
+
+      vector<llvm::Type *> putsArgs;
+      putsArgs.push_back(Builder.getInt8Ty()->getPointerTo());
+      llvm::ArrayRef<llvm::Type*> argsRef(putsArgs);
+
+      llvm::FunctionType *putsType =
+        llvm::FunctionType::get(Builder.getInt32Ty(), argsRef, true);
+      llvm::Constant *putsFunc = module->getOrInsertFunction("printf", putsType);
+
+      vector<llvm::Value *> CallArgs;
+      CallArgs.push_back(fmt);
+      CallArgs.push_back(value);
+      Builder.CreateCall(putsFunc, CallArgs);
+    }
+
+    bool CodeGen::wrapTopLevelBlockInMain(const BlockNode &block) {
       // generate void main()
       llvm::FunctionType *voidType = llvm::FunctionType::get(Builder.getVoidTy(), false);
       llvm::Function *mainFunc =
@@ -189,52 +241,27 @@ namespace lila {
 
       llvm::Value * lastExpr;
 
-      for (auto it = body->begin() ; it != body->end(); ++it) {
-        ASTNode * node = it->get();
+      frames.push_back(vector<llvm::Value*>(block.frameSize));
 
-        if (auto x = dynamic_cast<ValueAST*>(node)) {
-          auto code = generateCodeValue(x);
-          if (!code) return false;
+      for (auto node : ast->nodeList(block.body)) {
+        switch (node.kind()) {
+        case ASTKind::Value:
+          if (!generateCodeValue(ast->value(node))) return false;
+          break;
 
-        } else if (auto x = dynamic_cast<DefAST*>(node)) {
-          generateCodeDef(x);
+        case ASTKind::Def:
+          if (!generateCodeDef(ast->def(node))) return false;
           Builder.SetInsertPoint(MainBlock);
+          break;
 
-        } else if (auto x = dynamic_cast<NumberExprAST*>(node)) {
-          auto code = generateCodeNumber(x);
-          if (!code) return false;
-          lastExpr = code;
-
-        } else if (auto x = dynamic_cast<BinaryExprAST*>(node)) {
-          auto code = generateCodeBinOp(x);
-          if (!code) return false;
-          lastExpr = code;
-
-        } else if (auto x = dynamic_cast<CallAST*>(node)) {
-          auto code = generateCodeCall(x);
-          if (!code) return false;
-          lastExpr = code;
-
-        } else {
-          error = "can't handle ast";
-          return false;
+        default:
+          lastExpr = generateCodeExpr(node);
+          if (!lastExpr) return false;
+          break;
         }
       }
 
-      llvm::Value *fmt = Builder.CreateGlobalStringPtr("%lg\n");
-
-      vector<llvm::Type *> putsArgs;
-      putsArgs.push_back(Builder.getInt8Ty()->getPointerTo());
-      llvm::ArrayRef<llvm::Type*> argsRef(putsArgs);
-
-      llvm::FunctionType *putsType =
-        llvm::FunctionType::get(Builder.getInt32Ty(), argsRef, true);
-      llvm::Constant *putsFunc = module->getOrInsertFunction("printf", putsType);
-
-      vector<llvm::Value *> CallArgs;
-      CallArgs.push_back(fmt);
-      CallArgs.push_back(lastExpr);
-      Builder.CreateCall(putsFunc, CallArgs);
+      generateCodePrint(lastExpr);
 
       Builder.CreateRetVoid();
 
@@ -246,16 +273,17 @@ namespace lila {
         return false;
       }
 
-      // remove the main scope
-      removeScope();
+      frames.pop_back();
 
       return true;
     }
 
-    unique_ptr<CodegenResult> CodeGen::generateCode(unique_ptr<ASTNode> ast) {
+    unique_ptr<CodegenResult> CodeGen::generateCode(unique_ptr<AST> ast) {
+      this->ast = ast.get();
+
       // top level block
-      if (auto block = dynamic_cast<BlockAST*>(ast.get())) {
-        if (!wrapTopLevelBlockInMain(block)) {
+      if (ast->root && ast->root.kind() == ASTKind::Block) {
+        if (!wrapTopLevelBlockInMain(ast->block(ast->root))) {
           auto failure = llvm::make_unique<CodegenFailure>(error);
           return move(failure);
         }
@@ -269,5 +297,107 @@ namespace lila {
       return move(success);
     }
 
+    bool CodeGen::wrapInputInFunction(const BlockNode &block, const string &name) {
+      llvm::FunctionType *voidType = llvm::FunctionType::get(Builder.getVoidTy(), false);
+      llvm::Function *inputFunc =
+        llvm::Function::Create(voidType, llvm::Function::ExternalLinkage, name, module.get());
+
+      llvm::BasicBlock *InputBlock = llvm::BasicBlock::Create(context, "entry", inputFunc);
+      Builder.SetInsertPoint(InputBlock);
+
+      llvm::Value * lastExpr = nullptr;
+
+      for (auto node : ast->nodeList(block.body)) {
+        lastExpr = nullptr;
+
+        switch (node.kind()) {
+        case ASTKind::Value: {
+          const ValueNode &value = ast->value(node);
+          llvm::Value * exprCode = generateCodeValue(value);
+          if (!exprCode) return false;
+
+          // later inputs read vals that are not constant from a global
+          if (!llvm::isa<llvm::Constant>(exprCode)) {
+            auto global =
+              new llvm::GlobalVariable(*module, Builder.getDoubleTy(), false,
+                                       llvm::GlobalValue::ExternalLinkage,
+                                       llvm::ConstantFP::get(context, llvm::APFloat(0.0)),
+                                       llvm::Twine(prefix) + symbols.name(value.name));
+            Builder.CreateStore(exprCode, global);
+            frames.front()[value.slot] = global;
+          }
+          break;
+        }
+
+        case ASTKind::Def:
+          if (!generateCodeDef(ast->def(node))) return false;
+          Builder.SetInsertPoint(InputBlock);
+          break;
+
+        default:
+          lastExpr = generateCodeExpr(node);
+          if (!lastExpr) return false;
+          break;
+        }
+      }
+
+      if (lastExpr)
+        generateCodePrint(lastExpr);
+
+      Builder.CreateRetVoid();
+
+      string verifyS;
+      llvm::raw_string_ostream verifyE(verifyS);
+      if (verifyFunction(*inputFunc, &verifyE)) {
+        inputFunc->eraseFromParent();
+        error = "something wrong with auto-generated input function: " + verifyS;
+        return false;
+      }
+
+      return true;
+    }
+
+    unique_ptr<CodegenResult> CodeGen::generateInput(AST &session, const string &name) {
+      this->ast = &session;
+      module = llvm::make_unique<llvm::Module>(name, context);
+      prefix = name + ".";
+
+      if (!declarations)
+        declarations = llvm::make_unique<llvm::Module>("declarations", context);
+
+      if (!session.root || session.root.kind() != ASTKind::Block) {
+        auto failure = llvm::make_unique<CodegenFailure>("can't handle ast");
+        return move(failure);
+      }
+
+      // the top level frame is shared by all inputs
+      const BlockNode &block = session.block(session.root);
+      frames.resize(1);
+      size_t declared = frames.front().size();
+      frames.front().resize(block.frameSize);
+
+      if (!wrapInputInFunction(block, name)) {
+        // later inputs see the names of this input, but there is no code
+        frames.resize(1);
+        fill(frames.front().begin() + declared, frames.front().end(), nullptr);
+
+        auto failure = llvm::make_unique<CodegenFailure>(error);
+        return move(failure);
+      }
+
+      // the module is handed on, so refer to its symbols by declarations
+      for (size_t i = declared; i < frames.front().size(); i++) {
+        llvm::Value *&value = frames.front()[i];
+
+        if (auto function = llvm::dyn_cast_or_null<llvm::Function>(value))
+          value = declarations->getOrInsertFunction(function->getName(), function->getFunctionType());
+        else if (auto global = llvm::dyn_cast_or_null<llvm::GlobalVariable>(value))
+          value = declarations->getOrInsertGlobal(global->getName(), Builder.getDoubleTy());
+      }
+
+      auto success = llvm::make_unique<CodegenSuccess>(move(module));
+      return move(success);
+    }
+
   }
 }
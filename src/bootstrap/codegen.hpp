@@ -11,6 +11,7 @@
 #include <memory>
 
 #include <llvm/ADT/STLExtras.h>
+#include <llvm/Support/Casting.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Verifier.h>
@@ -24,92 +25,82 @@ namespace lila {
 
     class CodegenResult {
     public:
+      const bool success;
+      explicit CodegenResult(bool success) : success(success) {}
       virtual ~CodegenResult() {}
     };
 
     class CodegenSuccess : public CodegenResult {
     public:
       unique_ptr<llvm::Module> module;
-      explicit CodegenSuccess(unique_ptr<llvm::Module> module) : module(move(module)) {}
+      explicit CodegenSuccess(unique_ptr<llvm::Module> module)
+        : CodegenResult(true), module(move(module)) {}
+      static bool classof(const CodegenResult *result) {
+        return result->success;
+      }
     };
 
     class CodegenFailure : public CodegenResult {
     public:
       string msg;
-      explicit CodegenFailure(string msg) : msg(msg) {}
+      explicit CodegenFailure(string msg) : CodegenResult(false), msg(msg) {}
+      static bool classof(const CodegenResult *result) {
+        return !result->success;
+      }
     };
 
     class CodeGen {
       llvm::LLVMContext& context;
       llvm::IRBuilder<> Builder;
       unique_ptr<llvm::Module> module;
+      SymbolTable &symbols;
+      AST *ast = nullptr;
       string error;
-      vector<string> curscope;
-      map<string, map<string, llvm::Value*> > scoped_values;
-
-      void removeScope() {
-        curscope.pop_back();
-      }
-
-      string scopestr() {
-        return util::mkString(curscope, ".");
-      }
-
-      void addScope(string level) {
-        // first add to curscope
-        curscope.push_back(level);
-
-        // second add empty values to scope map
-        map<string, llvm::Value*> values;
-        scoped_values[scopestr()] = values;
-      }
-
-      void addScopedValue(string name, llvm::Value* value) {
-        string scope = scopestr();
-
-        auto values = scoped_values[scope];
-        values[name] = value;
-
-        scoped_values[scope] = values;
-      }
 
-      llvm::Value * findScopedValue(string name) {
-        // search from current scope outwards
-        for (int i = curscope.size(); i >= 0; i--) {
-          ostringstream oss;
-          for (int j = 0; j < i; j++) {
-            oss << curscope[j];
-            if (j < (i - 1)) oss << '.';
-          }
+      // values of the frames the resolver bound names to, see Binding
+      vector<vector<llvm::Value*> > frames;
 
-          string scope = oss.str();
+      // prefix of the names of functions and globals, see generateInput
+      string prefix;
 
-          map<string, llvm::Value*> values = scoped_values[scope];
+      // the defs and vals around the code being generated, e.g. "foo.x.",
+      // so nested defs of the same name get names of their own that do not
+      // depend on the rest of the program
+      string scope;
 
-          for (auto it = values.begin() ; it != values.end(); ++it)
-            if (name == it->first) return it->second;
-        }
+      // functions and globals of earlier inputs of an interactive session,
+      // whose modules are gone, the top level frame refers to these
+      unique_ptr<llvm::Module> declarations;
 
-        return nullptr;
-      }
+      llvm::Value * importValue(llvm::Value *value);
+      void generateCodePrint(llvm::Value *value);
+      bool wrapInputInFunction(const BlockNode &block, const string &name);
 
     public:
-      CodeGen(string modulename, llvm::LLVMContext& ctx)
-        : context(ctx), Builder(llvm::IRBuilder<>(ctx)) {
+      CodeGen(string modulename, llvm::LLVMContext& ctx, SymbolTable &symbols)
+        : context(ctx), Builder(llvm::IRBuilder<>(ctx)), symbols(symbols) {
         module = llvm::make_unique<llvm::Module>(modulename, context);
       }
 
-      llvm::Value * generateCodeExpr(ExprAST *ast);
-      llvm::Value * generateCodeNumber(NumberExprAST *ast);
-      llvm::Value * generateCodeBlock(BlockAST *ast);
-      llvm::Value * generateCodeBinOp(BinaryExprAST *ast);
-      llvm::Value * generateCodeCall(CallAST *ast);
-      llvm::Value * generateCodeValue(ValueAST *ast);
-      llvm::Function * generateCodeDef(DefAST *ast);
-
-      bool wrapTopLevelBlockInMain(BlockAST *ast);
-
-      unique_ptr<CodegenResult> generateCode(unique_ptr<ASTNode> ast);
+      llvm::Value * generateCodeExpr(Node node);
+      llvm::Value * generateCodeNumber(const NumberNode &number);
+      llvm::Value * generateCodeBlock(const BlockNode &block);
+      llvm::Value * generateCodeBinOp(const BinaryNode &binary);
+      llvm::Value * generateCodeCall(const CallNode &call);
+      llvm::Value * generateCodeValue(const ValueNode &value);
+      llvm::Function * generateCodeDef(const DefNode &def);
+
+      bool wrapTopLevelBlockInMain(const BlockNode &block);
+
+      unique_ptr<CodegenResult> generateCode(unique_ptr<AST> ast);
+
+      // Generates the root block of one input of an interactive session, see
+      // Resolver::resolveInput, into a module of its own. Its void function
+      // of the given name stores vals in globals and prints the value of a
+      // final expression. Functions and globals are prefixed with the name,
+      // so each input defines distinct symbols, and later inputs declare the
+      // ones of earlier inputs they use.
+      unique_ptr<CodegenResult> generateInput(AST &session, const string &name);
     };
 
   }
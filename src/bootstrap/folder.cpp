@@ -0,0 +1,303 @@
+/*            __ __                                                     *\
+**     __    /_// /  ___            lila bootstrap compiler             **
+**    / /   __ / /  / _ |           (c) 2016, Christian Krause          **
+**   / /__ / // /__/ __ |                                               **
+**  /____//_//____/_/ | |                                               **
+\*                    |/                                                */
+
+#include "folder.hpp"
+
+#include <iterator>
+
+namespace lila {
+  namespace folder {
+
+    void Folder::foldExpr(Node &node) {
+      switch (node.kind()) {
+      case ASTKind::BinaryExpr:
+        foldBinary(node);
+        break;
+      case ASTKind::Call:
+        foldCall(node);
+        break;
+      case ASTKind::Block:
+        foldBlock(node, false);
+        break;
+      default:
+        break;
+      }
+    }
+
+    void Folder::foldBlock(Node &node, bool topLevel) {
+      BlockNode &block = ast->block(node);
+
+      frames.push_back(vector<Constant>(block.frameSize));
+      Node lastExpr = foldBody(block);
+      frames.pop_back();
+
+      // vals and defs of the block are only visible within it, so a block
+      // with a constant result is that constant
+      if (!topLevel && lastExpr && lastExpr.kind() == ASTKind::Number)
+        node = lastExpr;
+    }
+
+    Node Folder::foldBody(BlockNode &block) {
+      Node lastExpr;
+
+      for (auto &item : ast->nodeList(block.body)) {
+        switch (item.kind()) {
+        case ASTKind::Value:
+          foldValue(ast->value(item));
+          break;
+        case ASTKind::Def:
+          foldDef(item);
+          break;
+        default:
+          foldExpr(item);
+          lastExpr = item;
+          break;
+        }
+      }
+
+      return lastExpr;
+    }
+
+    void Folder::foldBinary(Node &node) {
+      BinaryNode &binary = ast->binary(node);
+
+      foldExpr(binary.lhs);
+      foldExpr(binary.rhs);
+
+      if (binary.lhs.kind() != ASTKind::Number || binary.rhs.kind() != ASTKind::Number)
+        return;
+
+      double lhs = ast->number(binary.lhs).value;
+      double rhs = ast->number(binary.rhs).value;
+      double result;
+
+      if (binary.builtin != BuiltinOp::None) {
+        if (!evaluateBuiltin(binary.builtin, lhs, rhs, result))
+          return;
+      } else {
+        double args[] = { lhs, rhs };
+        if (!evaluateCall(binary.binding, args, result))
+          return;
+      }
+
+      node = ast->addNumber(result);
+    }
+
+    void Folder::foldCall(Node &node) {
+      CallNode &call = ast->call(node);
+
+      for (auto &arg : ast->nodeList(call.args))
+        foldExpr(arg);
+
+      if (!call.binding.def) {
+        const Constant &value = frames[call.binding.depth][call.binding.slot];
+
+        if (value.kind == Constant::Kind::Number)
+          node = ast->addNumber(value.value);
+
+        return;
+      }
+
+      vector<double> args;
+      for (auto arg : ast->nodeList(call.args)) {
+        if (arg.kind() != ASTKind::Number)
+          return;
+
+        args.push_back(ast->number(arg).value);
+      }
+
+      double result;
+      if (evaluateCall(call.binding, args, result))
+        node = ast->addNumber(result);
+    }
+
+    void Folder::foldValue(ValueNode &value) {
+      foldExpr(value.expr);
+
+      if (value.expr.kind() == ASTKind::Number)
+        frames.back()[value.slot] = Constant::number(ast->number(value.expr).value);
+    }
+
+    void Folder::foldDef(Node node) {
+      DefNode &def = ast->def(node);
+
+      // arguments are unknown within the body
+      frames.push_back(vector<Constant>(def.args.size));
+      foldExpr(def.body);
+      frames.pop_back();
+
+      frames.back()[def.slot] = Constant::function(node);
+    }
+
+    bool Folder::evaluateCall(Binding binding, llvm::ArrayRef<double> args, double &result) {
+      const Constant &callee = frames[binding.depth][binding.slot];
+
+      if (callee.kind != Constant::Kind::Def)
+        return false;
+
+      Node def = callee.def;
+      const DefNode &node = ast->def(def);
+
+      // code generation reports calls with the wrong number of arguments
+      if (node.args.size != args.size())
+        return false;
+
+      if (callDepth == 0)
+        steps = 0;
+      else if (callDepth == maxCallDepth)
+        return false;
+
+      // the body sees the frames up to the one the def is declared in and its
+      // arguments, the frames of the caller are set aside until it returns
+      auto begin = frames.begin() + binding.depth + 1;
+      vector<vector<Constant> > caller(make_move_iterator(begin), make_move_iterator(frames.end()));
+      frames.erase(begin, frames.end());
+
+      frames.push_back(vector<Constant>());
+      for (auto arg : args)
+        frames.back().push_back(Constant::number(arg));
+
+      callDepth++;
+      bool known = evaluate(node.body, result);
+      callDepth--;
+
+      frames.pop_back();
+      frames.insert(frames.end(), make_move_iterator(caller.begin()), make_move_iterator(caller.end()));
+
+      return known;
+    }
+
+    bool Folder::evaluate(Node node, double &result) {
+      if (++steps > budget)
+        return false;
+
+      switch (node.kind()) {
+      case ASTKind::Number:
+        result = ast->number(node).value;
+        return true;
+
+      case ASTKind::BinaryExpr: {
+        const BinaryNode &binary = ast->binary(node);
+        double lhs, rhs;
+
+        if (!evaluate(binary.lhs, lhs) || !evaluate(binary.rhs, rhs))
+          return false;
+
+        if (binary.builtin != BuiltinOp::None)
+          return evaluateBuiltin(binary.builtin, lhs, rhs, result);
+
+        double args[] = { lhs, rhs };
+        return evaluateCall(binary.binding, args, result);
+      }
+
+      case ASTKind::Call: {
+        const CallNode &call = ast->call(node);
+
+        if (!call.binding.def) {
+          const Constant &value = frames[call.binding.depth][call.binding.slot];
+          result = value.value;
+          return value.kind == Constant::Kind::Number;
+        }
+
+        vector<double> args;
+        for (auto arg : ast->nodeList(call.args)) {
+          double value;
+          if (!evaluate(arg, value))
+            return false;
+          args.push_back(value);
+        }
+
+        return evaluateCall(call.binding, args, result);
+      }
+
+      case ASTKind::Block:
+        return evaluateBlock(ast->block(node), result);
+
+      default:
+        return false;
+      }
+    }
+
+    bool Folder::evaluateBlock(const BlockNode &block, double &result) {
+      bool known = false;
+
+      frames.push_back(vector<Constant>(block.frameSize));
+
+      for (auto item : ast->nodeList(block.body)) {
+        switch (item.kind()) {
+        case ASTKind::Value: {
+          const ValueNode &value = ast->value(item);
+          double number;
+
+          if (!evaluate(value.expr, number)) {
+            frames.pop_back();
+            return false;
+          }
+
+          frames.back()[value.slot] = Constant::number(number);
+          break;
+        }
+
+        case ASTKind::Def:
+          frames.back()[ast->def(item).slot] = Constant::function(item);
+          break;
+
+        default:
+          known = evaluate(item, result);
+          if (!known) {
+            frames.pop_back();
+            return false;
+          }
+          break;
+        }
+      }
+
+      frames.pop_back();
+      return known;
+    }
+
+    bool Folder::evaluateBuiltin(BuiltinOp op, double lhs, double rhs, double &result) {
+      switch (op) {
+      case BuiltinOp::Add:
+        result = lhs + rhs;
+        return true;
+      case BuiltinOp::Subtract:
+        result = lhs - rhs;
+        return true;
+      case BuiltinOp::Multiply:
+        result = lhs * rhs;
+        return true;
+      default:
+        return false;
+      }
+    }
+
+    void Folder::fold(AST &ast) {
+      this->ast = &ast;
+      frames.clear();
+
+      if (ast.root && ast.root.kind() == ASTKind::Block)
+        foldBlock(ast.root, true);
+    }
+
+    void Folder::foldInput(AST &session) {
+      ast = &session;
+
+      if (!ast->root || ast->root.kind() != ASTKind::Block)
+        return;
+
+      BlockNode &block = ast->block(ast->root);
+
+      if (frames.empty())
+        frames.push_back(vector<Constant>());
+
+      frames.front().resize(block.frameSize);
+      foldBody(block);
+    }
+
+  }
+}
@@ -0,0 +1,94 @@
+/*            __ __                                                     *\
+**     __    /_// /  ___            lila bootstrap compiler             **
+**    / /   __ / /  / _ |           (c) 2016, Christian Krause          **
+**   / /__ / // /__/ __ |                                               **
+**  /____//_//____/_/ | |                                               **
+\*                    |/                                                */
+
+#ifndef LILA_FOLDER_H
+#define LILA_FOLDER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "ast.hpp"
+
+using namespace std;
+using namespace lila::ast;
+
+namespace lila {
+  namespace folder {
+
+    // what the folder knows about a frame slot
+    class Constant {
+    public:
+      enum class Kind : uint8_t { Unknown, Number, Def };
+
+      Kind kind = Kind::Unknown;
+      double value = 0; // if Number
+      Node def;         // if Def
+
+      static Constant number(double value) {
+        Constant constant;
+        constant.kind = Kind::Number;
+        constant.value = value;
+        return constant;
+      }
+
+      static Constant function(Node def) {
+        Constant constant;
+        constant.kind = Kind::Def;
+        constant.def = def;
+        return constant;
+      }
+    };
+
+    // Replaces expressions of a resolved AST that only depend on numbers by
+    // their value: arithmetic, vals bound to constants, blocks ending in a
+    // constant and calls of defs with constant arguments, which are evaluated
+    // at compile time. Arithmetic is done in double as the generated code
+    // would. Defs can't call themselves, so evaluation always terminates, but
+    // it may take long: a call that needs more than the budget of evaluation
+    // steps is left to the generated code.
+    class Folder {
+    private:
+      AST *ast = nullptr;
+
+      // constants of the frames the resolver bound names to, see Binding
+      vector<vector<Constant> > frames;
+
+      const uint32_t budget;
+      uint32_t steps = 0;
+      uint32_t callDepth = 0;
+
+      static const uint32_t maxCallDepth = 512;
+
+      void foldExpr(Node &node);
+      void foldBlock(Node &node, bool topLevel);
+      Node foldBody(BlockNode &block);
+      void foldBinary(Node &node);
+      void foldCall(Node &node);
+      void foldValue(ValueNode &value);
+      void foldDef(Node node);
+
+      // evaluation of a call with constant arguments within the budget
+      bool evaluateCall(Binding binding, llvm::ArrayRef<double> args, double &result);
+
+      bool evaluate(Node node, double &result);
+      bool evaluateBlock(const BlockNode &block, double &result);
+      bool evaluateBuiltin(BuiltinOp op, double lhs, double rhs, double &result);
+
+    public:
+      explicit Folder(uint32_t budget = 100000) : budget(budget) {}
+
+      void fold(AST &ast);
+
+      // folds the root block of one input of an interactive session, in the
+      // top level frame of the session, see Resolver::resolveInput
+      void foldInput(AST &session);
+    };
+
+  }
+}
+
+#endif
@@ -0,0 +1,92 @@
+/*            __ __                                                     *\
+**     __    /_// /  ___            lila bootstrap compiler             **
+**    / /   __ / /  / _ |           (c) 2016, Christian Krause          **
+**   / /__ / // /__/ __ |                                               **
+**  /____//_//____/_/ | |                                               **
+\*                    |/                                                */
+
+#include "jit.hpp"
+
+#include <vector>
+
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ExecutionEngine/Orc/LambdaResolver.h>
+#include <llvm/ExecutionEngine/RTDyldMemoryManager.h>
+#include <llvm/ExecutionEngine/SectionMemoryManager.h>
+#include <llvm/IR/Mangler.h>
+#include <llvm/Support/DynamicLibrary.h>
+#include <llvm/Support/raw_ostream.h>
+
+namespace lila {
+  namespace jit {
+
+    JIT::JIT(unique_ptr<llvm::TargetMachine> target)
+      : target(move(target)),
+        dataLayout(*this->target->getDataLayout()),
+        compileLayer(objectLayer, llvm::orc::SimpleCompiler(*this->target)) {
+      // symbols of the process itself
+      llvm::sys::DynamicLibrary::LoadLibraryPermanently(nullptr);
+    }
+
+    string JIT::mangle(const string &name) {
+      string mangled;
+      llvm::raw_string_ostream stream(mangled);
+      llvm::Mangler::getNameWithPrefix(stream, name, dataLayout);
+      return stream.str();
+    }
+
+    llvm::orc::JITSymbol JIT::findMangledSymbol(const string &name) {
+      auto definition = definitions.find(name);
+
+      if (definition == definitions.end())
+        return nullptr;
+
+      return compileLayer.findSymbolIn(definition->second, name, false);
+    }
+
+    JIT::ModuleHandle JIT::addModule(unique_ptr<llvm::Module> module) {
+      vector<string> names;
+
+      for (auto &function : *module)
+        if (!function.isDeclaration())
+          names.push_back(mangle(function.getName()));
+
+      for (auto &global : module->globals())
+        if (!global.isDeclaration() && !global.hasLocalLinkage())
+          names.push_back(mangle(global.getName()));
+
+      // symbols of earlier modules first, then those of the process
+      auto resolver = llvm::orc::createLambdaResolver(
+        [this](const string &name) {
+          if (auto symbol = findMangledSymbol(name))
+            return llvm::RuntimeDyld::SymbolInfo(symbol.getAddress(), symbol.getFlags());
+          return llvm::RuntimeDyld::SymbolInfo(nullptr);
+        },
+        [](const string &name) {
+          if (auto address = llvm::RTDyldMemoryManager::getSymbolAddressInProcess(name))
+            return llvm::RuntimeDyld::SymbolInfo(address, llvm::JITSymbolFlags::Exported);
+          return llvm::RuntimeDyld::SymbolInfo(nullptr);
+        });
+
+      vector<unique_ptr<llvm::Module> > modules;
+      modules.push_back(move(module));
+
+      auto handle = compileLayer.addModuleSet(move(modules),
+                                              llvm::make_unique<llvm::SectionMemoryManager>(),
+                                              move(resolver));
+
+      for (auto &name : names)
+        definitions[name] = handle;
+
+      return handle;
+    }
+
+    uint64_t JIT::getSymbolAddress(const string &name) {
+      if (auto symbol = findMangledSymbol(mangle(name)))
+        return symbol.getAddress();
+
+      return 0;
+    }
+
+  }
+}
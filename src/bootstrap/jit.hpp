@@ -0,0 +1,67 @@
+/*            __ __                                                     *\
+**     __    /_// /  ___            lila bootstrap compiler             **
+**    / /   __ / /  / _ |           (c) 2016, Christian Krause          **
+**   / /__ / // /__/ __ |                                               **
+**  /____//_//____/_/ | |                                               **
+\*                    |/                                                */
+
+#ifndef LILA_JIT_H
+#define LILA_JIT_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ExecutionEngine/Orc/CompileUtils.h>
+#include <llvm/ExecutionEngine/Orc/IRCompileLayer.h>
+#include <llvm/ExecutionEngine/Orc/ObjectLinkingLayer.h>
+#include <llvm/IR/DataLayout.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Target/TargetMachine.h>
+
+using namespace std;
+
+namespace lila {
+  namespace jit {
+
+    // Compiles modules in memory for the host and links them against each
+    // other and the running process, so e.g. printf resolves to the printf
+    // of lilac itself. Modules are prepared and optimized by the backend
+    // before they are added.
+    class JIT {
+    public:
+      typedef llvm::orc::IRCompileLayer<llvm::orc::ObjectLinkingLayer<> >::ModuleSetHandleT ModuleHandle;
+
+    private:
+      unique_ptr<llvm::TargetMachine> target;
+      const llvm::DataLayout dataLayout;
+      llvm::orc::ObjectLinkingLayer<> objectLayer;
+      llvm::orc::IRCompileLayer<llvm::orc::ObjectLinkingLayer<> > compileLayer;
+
+      // module defining each mangled symbol, so a lookup does not search all
+      // modules of a long interactive session
+      llvm::StringMap<ModuleHandle> definitions;
+
+      string mangle(const string &name);
+      llvm::orc::JITSymbol findMangledSymbol(const string &name);
+
+    public:
+      // target as from backend::createTargetMachine for the JIT
+      explicit JIT(unique_ptr<llvm::TargetMachine> target);
+
+      llvm::TargetMachine &getTargetMachine() {
+        return *target;
+      }
+
+      // compiles the module, its symbols hide those of earlier modules
+      ModuleHandle addModule(unique_ptr<llvm::Module> module);
+
+      // address of a symbol of the added modules, 0 if there is none
+      uint64_t getSymbolAddress(const string &name);
+    };
+
+  }
+}
+
+#endif
@@ -6,138 +6,172 @@
 \*                    |/                                                */
 
 #include "lexer.hpp"
+#include "scan.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
 
 namespace lila {
   namespace lexer {
 
-    unique_ptr<LexerResult> tokenize(basic_istream<char>* is) {
-      auto tokens = llvm::make_unique<vector<unique_ptr<Token> > >();
-
-      unsigned int blocks = 0;
-      unsigned int parens = 0;
-      char c;
-      is->get(c);
-
-      while (is && !is->eof()) {
-        if (isdigit(c)) { // number: [0-9]+
-          string number;
-          number += c;
-
-          bool hasdot = false;
-
-          while (is && is->get(c)) {
-            if (isdigit(c))
-              number += c;
-            else if (c == '.' && !hasdot) {
-              number += c;
-              hasdot = true;
-            } else
-              break;
-          }
+    static double parseNumber(const char * begin, const char * end) {
+      // the source is not terminated after the number, so strtod needs a copy
+      // that stops where the lexer decided the number ends
+      size_t length = end - begin;
+      char buffer[64];
+
+      if (length < sizeof(buffer)) {
+        memcpy(buffer, begin, length);
+        buffer[length] = '\0';
+        return strtod(buffer, nullptr);
+      }
 
-          double value = strtod(number.c_str(), nullptr);
-          auto token = llvm::make_unique<NumberToken>(value);
-          tokens->push_back(move(token));
+      string number(begin, end);
+      return strtod(number.c_str(), nullptr);
+    }
+
+    bool Lexer::next(Token &token) {
+      if (dotPending) {
+        // ... to add final dot to tokens to allow for:
+        //   number.method, e.g.:
+        //     5.abs
+        //   number.method(args), e.g.:
+        //     5.max(6)
+        dotPending = false;
+        make(token, TokenKind::Dot, p - 1, p);
+        return true;
+      }
+
+      while (p < end) {
+        unsigned char c = *p;
+
+        if (isDigit(c)) { // number: [0-9]+(\.[0-9]*)?
+          const char * start = p;
+
+          p = scanDigits(p + 1, end);
+
+          if (p < end && *p == '.')
+            p = scanDigits(p + 1, end);
 
           // check if last char of number is a dot ...
-          if (number.back() == '.') {
-            // ... to add final dot to tokens to allow for:
-            //   number.method, e.g.:
-            //     5.abs
-            //   number.method(args), e.g.:
-            //     5.max(6)
-            auto token = llvm::make_unique<DotToken>();
-            tokens->push_back(move(token));
+          if (p[-1] == '.') {
+            dotPending = true;
+            make(token, TokenKind::Number, start, p - 1, parseNumber(start, p));
+          } else {
+            make(token, TokenKind::Number, start, p, parseNumber(start, p));
           }
 
-        } else if (isalpha(c)) { // [a-zA-Z][a-zA-Z0-9]* token
-          string str;
-          str += c;
+          return true;
+
+        } else if (isAlpha(c)) { // [a-zA-Z][a-zA-Z0-9]* token
+          const char * start = p;
 
-          while (is && is->get(c) && isalnum(c))
-            str += c;
+          p = scanAlnum(p + 1, end);
 
-          if (str.compare("def") == 0) {
-            auto token = llvm::make_unique<DefToken>();
-            tokens->push_back(move(token));
-          } else if (str.compare("val") == 0) {
-            auto token = llvm::make_unique<ValueToken>();
-            tokens->push_back(move(token));
+          llvm::StringRef str(start, p - start);
+
+          if (str == "def") {
+            make(token, TokenKind::Def, start, p);
+          } else if (str == "val") {
+            make(token, TokenKind::Value, start, p);
           } else {
-            auto token = llvm::make_unique<OtherToken>(str);
-            tokens->push_back(move(token));
+            makeSymbol(token, start, p);
           }
 
+          return true;
+
         } else if (c == ',') {
-          auto token = llvm::make_unique<CommaToken>();
-          tokens->push_back(move(token));
-          is->get(c);
+          make(token, TokenKind::Comma, p, p + 1);
+          p++;
+          return true;
 
         } else if (c == '{') {
           blocks++;
-          auto token = llvm::make_unique<BlockOpen>();
-          tokens->push_back(move(token));
-          is->get(c);
+          make(token, TokenKind::BlockOpen, p, p + 1);
+          p++;
+          return true;
 
         } else if (c == '}') {
           if (blocks == 0) {
-            auto failure = llvm::make_unique<LexerFailure>("closing block when none is open");
-            return move(failure);
+            error = "closing block when none is open";
+            return false;
           } else {
             blocks--;
-            auto token = llvm::make_unique<BlockClose>();
-            tokens->push_back(move(token));
-            is->get(c);
+            make(token, TokenKind::BlockClose, p, p + 1);
+            p++;
+            return true;
           }
 
         } else if (c == '(') {
           parens++;
-          auto token = llvm::make_unique<ParenOpen>();
-          tokens->push_back(move(token));
-          is->get(c);
+          make(token, TokenKind::ParenOpen, p, p + 1);
+          p++;
+          return true;
 
         } else if (c == ')') {
           if (parens == 0) {
-            auto failure = llvm::make_unique<LexerFailure>("closing parens when none is open");
-            return move(failure);
+            error = "closing parens when none is open";
+            return false;
           } else {
             parens--;
-            auto token = llvm::make_unique<ParenClose>();
-            tokens->push_back(move(token));
-            is->get(c);
+            make(token, TokenKind::ParenClose, p, p + 1);
+            p++;
+            return true;
           }
 
-        } else if (ispunct(c)) { // punctuation token
-          string str;
-          str += c;
+        } else if (isPunct(c)) { // punctuation token
+          const char * start = p;
 
-          while (is && is->get(c) && ispunct(c))
-            str += c;
+          p = scanPunct(p + 1, end);
 
-          if (str.compare("=") == 0) {
-            auto token = llvm::make_unique<AssignmentToken>();
-            tokens->push_back(move(token));
-          } else if (str.compare(":") == 0) {
-            auto token = llvm::make_unique<ColonToken>();
-            tokens->push_back(move(token));
+          llvm::StringRef str(start, p - start);
+
+          if (str == "=") {
+            make(token, TokenKind::Assignment, start, p);
+          } else if (str == ":") {
+            make(token, TokenKind::Colon, start, p);
           } else {
-            auto token = llvm::make_unique<OtherToken>(str);
-            tokens->push_back(move(token));
+            makeSymbol(token, start, p);
           }
 
+          return true;
+
         } else if (c == '\n') {
-          auto token = llvm::make_unique<NewlineToken>();
-          tokens->push_back(move(token));
-          is->get(c);
+          make(token, TokenKind::Newline, p, p + 1);
+          p++;
+          return true;
 
         } else { // ignore
-          is->get(c);
+          p = scanBlank(p + 1, end);
         }
       }
 
-      auto success = llvm::make_unique<LexerSuccess>(move(tokens));
+      return false;
+    }
+
+    unique_ptr<LexerResult> tokenize(unique_ptr<llvm::MemoryBuffer> source, SymbolTable &symbols) {
+      auto tokens = llvm::make_unique<TokenStream>(source->getBuffer());
+
+      Lexer lexer(source->getBuffer(), symbols);
+      Token token;
+
+      while (lexer.next(token))
+        tokens->push(token);
+
+      if (lexer.failed()) {
+        auto failure = llvm::make_unique<LexerFailure>(lexer.error);
+        return move(failure);
+      }
+
+      auto success = llvm::make_unique<LexerSuccess>(move(source), move(tokens));
       return move(success);
     }
 
+    unique_ptr<LexerResult> tokenize(basic_istream<char>* is, SymbolTable &symbols) {
+      string code((istreambuf_iterator<char>(*is)), istreambuf_iterator<char>());
+      return tokenize(llvm::MemoryBuffer::getMemBufferCopy(code, "<stream>"), symbols);
+    }
+
   }
 }
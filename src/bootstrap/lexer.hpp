@@ -8,7 +8,11 @@
 #ifndef LILA_LEXER_H
 #define LILA_LEXER_H
 
+#include <istream>
+
 #include <llvm/ADT/STLExtras.h>
+#include <llvm/Support/Casting.h>
+#include <llvm/Support/MemoryBuffer.h>
 
 #include "token.hpp"
 
@@ -19,23 +23,79 @@ namespace lila {
 
     class LexerResult {
     public:
+      const bool success;
+      explicit LexerResult(bool success) : success(success) {}
       virtual ~LexerResult() {}
     };
 
     class LexerSuccess : public LexerResult {
     public:
-      unique_ptr<vector<unique_ptr<Token> > > tokens;
-      explicit LexerSuccess(unique_ptr<vector<unique_ptr<Token> > > tokens)
-        : tokens(move(tokens)) {}
+      // tokens refer to byte ranges of source, so it is kept alive with them
+      unique_ptr<llvm::MemoryBuffer> source;
+      unique_ptr<TokenStream> tokens;
+      explicit LexerSuccess(unique_ptr<llvm::MemoryBuffer> source,
+                            unique_ptr<TokenStream> tokens)
+        : LexerResult(true), source(move(source)), tokens(move(tokens)) {}
+      static bool classof(const LexerResult *result) {
+        return result->success;
+      }
     };
 
     class LexerFailure : public LexerResult {
     public:
       string msg;
-      explicit LexerFailure(string msg) : msg(msg) {}
+      explicit LexerFailure(string msg) : LexerResult(false), msg(msg) {}
+      static bool classof(const LexerResult *result) {
+        return !result->success;
+      }
     };
 
-    unique_ptr<LexerResult> tokenize(basic_istream<char>* is);
+    // Cursor over a source buffer that lexes one token per call to next().
+    class Lexer {
+    private:
+      llvm::StringRef source;
+      const char * p;
+      const char * end;
+      unsigned int blocks = 0;
+      unsigned int parens = 0;
+      bool dotPending = false;
+
+      SymbolTable &symbols;
+
+      void make(Token &token, TokenKind kind, const char * begin, const char * end,
+                double number = 0) {
+        token.kind = kind;
+        token.offset = begin - source.begin();
+        token.length = end - begin;
+        token.value.number = number;
+      }
+
+      void makeSymbol(Token &token, const char * begin, const char * end) {
+        make(token, TokenKind::Other, begin, end);
+        token.value.symbol = symbols.intern(llvm::StringRef(begin, end - begin));
+      }
+
+    public:
+      string error;
+
+      explicit Lexer(llvm::StringRef source, SymbolTable &symbols)
+        : source(source), p(source.begin()), end(source.end()), symbols(symbols) {}
+
+      llvm::StringRef getSource() const {
+        return source;
+      }
+
+      bool failed() const {
+        return !error.empty();
+      }
+
+      // returns false at the end of the source or on error
+      bool next(Token &token);
+    };
+
+    unique_ptr<LexerResult> tokenize(unique_ptr<llvm::MemoryBuffer> source, SymbolTable &symbols);
+
+    unique_ptr<LexerResult> tokenize(basic_istream<char>* is, SymbolTable &symbols);
 
   }
 }
@@ -0,0 +1,211 @@
+/*            __ __                                                     *\
+**     __    /_// /  ___            lila bootstrap compiler             **
+**    / /   __ / /  / _ |           (c) 2016, Christian Krause          **
+**   / /__ / // /__/ __ |                                               **
+**  /____//_//____/_/ | |                                               **
+\*                    |/                                                */
+
+#include <getopt.h>
+#include <unistd.h>
+#include <iostream>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "backend.hpp"
+#include "codegen.hpp"
+#include "folder.hpp"
+#include "jit.hpp"
+#include "parser.hpp"
+#include "resolver.hpp"
+
+using namespace lila::backend;
+using namespace lila::codegen;
+using namespace lila::folder;
+using namespace lila::jit;
+using namespace lila::parser;
+using namespace lila::resolver;
+
+// how many braces and parentheses the line opens
+static int nesting(const string &line) {
+  int depth = 0;
+
+  for (char c : line)
+    if (c == '(' || c == '{')
+      depth++;
+    else if (c == ')' || c == '}')
+      depth--;
+
+  return depth;
+}
+
+int main(int argc, char** argv) {
+
+  bool verbose = false;
+  OptLevel optLevel;
+
+  // ---------------------------------------------------------------------------
+  // parse command line options
+  // ---------------------------------------------------------------------------
+
+  char usage [1024];
+  snprintf(usage,
+           1024,
+           "%s\n"
+           "\n"
+           "usage: lila [OPTIONS]\n"
+           "\n"
+           "reads vals, defs and expressions from STDIN and prints the value of\n"
+           "each expression, an input goes on while braces or parentheses are open\n"
+           "\n"
+           "options:\n"
+           "    -O LEVEL         optimization level, one of 0, 1, 2, 3, s, z\n"
+           "                     defaults to 2\n"
+           "    -v               verbose output\n"
+           "\n",
+           PACKAGE_STRING
+           );
+
+  static const struct option longopts[] = {
+    { "help", no_argument, nullptr, 'h' },
+    { nullptr, 0, nullptr, 0 }
+  };
+
+  int c;
+  while ((c = getopt_long (argc, argv, "hO:v", longopts, nullptr)) != -1)
+    switch (c) {
+    case 'h':
+      cout << usage;
+      return 0;
+    case 'O':
+      if (!parseOptLevel(optarg, optLevel)) {
+        cerr << "unknown optimization level: " << optarg << endl;
+        cerr << usage;
+        return 1;
+      }
+      break;
+    case 'v':
+      verbose = true;
+      break;
+    default:
+      cerr << usage;
+      return 1;
+    }
+
+  // ---------------------------------------------------------------------------
+  // session state
+  // ---------------------------------------------------------------------------
+
+  string error;
+  auto target = createTargetMachine(optLevel, error, true);
+
+  if (!target) {
+    cerr << error << endl;
+    return 1;
+  }
+
+  // of all modules of the session, so it outlives the JIT
+  llvm::LLVMContext context;
+  JIT jit(move(target));
+
+  // everything an input defines stays for the inputs after it: names and
+  // operators, the nodes of the AST, the top level frame of resolver, folder
+  // and code generator and the compiled code in the JIT
+  SymbolTable symbols;
+  OperatorTable operators(symbols);
+  AST session;
+  Resolver resolver(symbols);
+  Folder folder;
+  CodeGen codegen("lila", context, symbols);
+
+  bool interactive = isatty(STDIN_FILENO);
+  string input, line;
+  int depth = 0;
+  unsigned count = 0;
+
+  // ---------------------------------------------------------------------------
+  // read, compile and run each input
+  // ---------------------------------------------------------------------------
+
+  while (true) {
+    if (interactive)
+      cout << (input.empty() ? "lila> " : "    | ") << flush;
+
+    if (!getline(cin, line))
+      break;
+
+    input += line;
+    input += '\n';
+
+    depth += nesting(line);
+    if (depth > 0)
+      continue;
+
+    depth = 0;
+    string name = "input" + to_string(++count);
+
+    Lexer lexer(input, symbols);
+    Parser parser(&lexer, symbols, operators);
+
+    auto parserResult = parser.parseInput(session);
+    input.clear();
+
+    if (lexer.failed()) {
+      cerr << "[lexer] [error] " << lexer.error << endl;
+      continue;
+    }
+
+    if (auto failure = llvm::dyn_cast<ParserFailure>(parserResult.get())) {
+      cerr << "[parser] [error] " << failure->msg << endl;
+      continue;
+    }
+
+    // empty line
+    if (!session.root)
+      continue;
+
+    auto resolverResult = resolver.resolveInput(session);
+
+    if (auto failure = llvm::dyn_cast<ResolverFailure>(resolverResult.get())) {
+      cerr << "[resolver] [error] " << failure->msg << endl;
+      continue;
+    }
+
+    folder.foldInput(session);
+
+    if (verbose)
+      cerr << "[ast]" << endl << session.toString(session.root, symbols) << "[/ast]" << endl;
+
+    auto cgresult = codegen.generateInput(session, name);
+
+    if (auto failure = llvm::dyn_cast<CodegenFailure>(cgresult.get())) {
+      cerr << "[codegen] [error] " << failure->msg << endl;
+      continue;
+    }
+
+    auto module = move(llvm::cast<CodegenSuccess>(cgresult.get())->module);
+
+    prepareModule(*module, jit.getTargetMachine(), optLevel);
+    optimizeModule(*module, jit.getTargetMachine(), optLevel);
+
+    if (verbose)
+      module->dump();
+
+    jit.addModule(move(module));
+
+    auto inputFunc = (void (*)()) jit.getSymbolAddress(name);
+
+    if (!inputFunc) {
+      cerr << "[jit] [error] " << name << " not found" << endl;
+      continue;
+    }
+
+    inputFunc();
+  }
+
+  if (interactive)
+    cout << endl;
+
+  return 0;
+}
@@ -5,245 +5,437 @@
 **  /____//_//____/_/ | |                                               **
 \*                    |/                                                */
 
-#include <fstream>
 #include <getopt.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
 
-#include <llvm/Analysis/TargetLibraryInfo.h>
-#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/StringSet.h>
 #include <llvm/Support/FileSystem.h>
-#include <llvm/Support/TargetRegistry.h>
-#include <llvm/Support/TargetSelect.h>
-#include <llvm/Support/ToolOutputFile.h>
-#include <llvm/Target/TargetMachine.h>
-#include <llvm/Target/TargetSubtargetInfo.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
 
-#include "codegen.hpp"
-#include "parser.hpp"
+#include "backend.hpp"
+#include "server.hpp"
+#include "session.hpp"
+#include "trace.hpp"
+
+using namespace lila::backend;
+using namespace lila::server;
+using namespace lila::session;
+using namespace lila::trace;
+
+// long options without a short one
+enum {
+  CacheDirOption = 256,
+  CacheSizeOption,
+  DaemonOption,
+  EmitOption,
+  IncrementalOption,
+  ServerOption,
+  TimeTraceOption
+};
+
+// -----------------------------------------------------------------------------
+// compile on a server
+// -----------------------------------------------------------------------------
+
+static string absolutePath(const char *path) {
+  llvm::SmallString<128> absolute(path);
+  llvm::sys::fs::make_absolute(absolute);
+  return absolute.str().str();
+}
+
+// Compiles input on the server listening at socket, which has loaded LLVM
+// and created its target machines before, or in session if there is no
+// server that takes the request. Returns the exit status and the diagnostics.
+static int compileInput(const char *socket, Session &session, const char *input,
+                        const char *output, string &diagnostics) {
+  const Options &options = session.getOptions();
+
+  if (!socket || llvm::StringRef(output) == "-") {
+    int status = session.compile(input, output);
+    diagnostics = session.takeDiagnostics();
+    return status;
+  }
+
+  Request request;
+  unique_ptr<llvm::MemoryBuffer> buffer;
+
+  // the server can not read the STDIN of the client
+  if (llvm::StringRef(input) == "-") {
+    auto source = llvm::MemoryBuffer::getSTDIN();
 
-using namespace lila::codegen;
-using namespace lila::parser;
+    if (!source) {
+      diagnostics = string("error opening file: ") + input + "\n";
+      return 1;
+    }
+
+    buffer = move(*source);
+    request.input = input;
+    request.hasSource = true;
+    request.source = buffer->getBuffer();
+  } else {
+    request.input = absolutePath(input);
+  }
+
+  request.output = absolutePath(output);
+  request.optLevel = options.optLevel;
+  request.fileType = options.fileType;
+  request.splitJobs = options.splitJobs;
+  request.verbose = options.verbose;
+  request.streaming = options.streaming;
+  request.cacheDir = options.cacheDir.empty() ? "" : absolutePath(options.cacheDir.c_str());
+  request.incrementalDir = options.incrementalDir.empty() ? "" : absolutePath(options.incrementalDir.c_str());
+  request.cacheSize = options.cacheSize;
+
+  Response response;
+  string error;
+
+  if (forward(socket, PACKAGE_STRING, request, response, error)) {
+    diagnostics = response.log;
+    return response.status;
+  }
+
+  int status = buffer
+    ? session.compile(move(buffer), input, output)
+    : session.compile(input, output);
+
+  diagnostics = options.verbose ? "[server] " + error + ", compiling without it\n" : "";
+  diagnostics += session.takeDiagnostics();
+  return status;
+}
+
+// Stays resident and compiles the requests of clients, workers of them at a
+// time. Each worker keeps a session, and so a target machine, per
+// optimization level.
+static int serveRequests(const char *socket, unsigned workers, bool verbose) {
+  typedef map<pair<unsigned, unsigned>, unique_ptr<Session> > Sessions;
+  vector<Sessions> sessions(workers);
+  std::mutex logMutex;
+
+  initializeTargets();
+
+  auto handle = [&](unsigned worker, const Request &request, Response &response) {
+    Options options;
+    options.optLevel = request.optLevel;
+    options.fileType = request.fileType;
+    options.splitJobs = request.splitJobs;
+    options.verbose = request.verbose;
+    options.streaming = request.streaming;
+    options.cacheDir = request.cacheDir;
+    options.incrementalDir = request.incrementalDir;
+    options.cacheSize = request.cacheSize;
+
+    auto &session = sessions[worker][make_pair(options.optLevel.speed, options.optLevel.size)];
+
+    if (session)
+      session->setOptions(options);
+    else
+      session = llvm::make_unique<Session>(options);
+
+    const char *input = request.input.c_str();
+    const char *output = request.output.c_str();
+
+    response.status = request.hasSource
+      ? session->compile(llvm::MemoryBuffer::getMemBufferCopy(request.source, input), input, output)
+      : session->compile(input, output);
+    response.log = session->takeDiagnostics();
+
+    if (verbose) {
+      std::lock_guard<std::mutex> lock(logMutex);
+      cerr << "[server] " << input << " -> " << output
+           << (response.status == 0 ? "" : " failed") << endl;
+    }
+  };
+
+  string error;
+  serve(socket, PACKAGE_STRING, workers, handle, error);
+
+  cerr << error << endl;
+  return 1;
+}
 
 int main(int argc, char** argv) {
 
   const char *input = "-";
-  const char *output = "a.out.o";
+  const char *output = nullptr;
+  const char *traceFile = nullptr;
+  const char *daemonSocket = nullptr;
+  unsigned jobs = 0;
+  const char *serverSocket = getenv("LILAC_SERVER");
 
-  bool verbose = false;
+  Options options;
 
   // ---------------------------------------------------------------------------
   // parse command line options
   // ---------------------------------------------------------------------------
 
-  char usage [1024];
+  char usage [4096];
   snprintf(usage,
-           1024,
+           4096,
            "%s\n"
            "\n"
-           "usage: lilac [OPTIONS] INPUT\n"
+           "usage: lilac [OPTIONS] INPUT...\n"
            "\n"
            "options:\n"
+           "    -j JOBS          split the program and optimize and compile\n"
+           "                     the parts on JOBS threads, or with several\n"
+           "                     INPUTs, compile JOBS of them at a time\n"
+           "    -O LEVEL         optimization level, one of 0, 1, 2, 3, s, z\n"
+           "                     defaults to 2\n"
            "    -o FILENAME      write output to FILENAME\n"
-           "                     if omitted, writes to %s\n"
+           "                     if omitted, writes to a.out.o or, with several\n"
+           "                     INPUTs, each to its name ending in .o, the\n"
+           "                     extension follows --emit\n"
+           "    -r, --run        compile in memory and run the program\n"
+           "                     instead of writing an object file\n"
+           "    -s               stream tokens from the lexer to the parser\n"
+           "                     instead of tokenizing the whole INPUT first\n"
            "    -v               verbose output\n"
-           "    INPUT            read source code from INPUT\n"
+           "    --cache-dir=DIR  reuse object files compiled before from the\n"
+           "                     same source and options, kept in DIR\n"
+           "    --emit=KIND      write a native object (obj), assembly (asm),\n"
+           "                     LLVM IR (llvm) or LLVM bitcode (bc), which\n"
+           "                     are .o, .s, .ll and .bc files, defaults to obj\n"
+           "    --cache-size=MB  size limit of the cache and the incremental\n"
+           "                     directory in MiB, defaults to %llu\n"
+           "    --time-trace=FILE\n"
+           "                     write the time and memory of each phase as\n"
+           "                     Chrome trace events to FILE, and a summary\n"
+           "    --incremental=DIR\n"
+           "                     keep the objects of the parts of programs in\n"
+           "                     DIR and compile only the changed parts again\n"
+           "    --daemon=SOCKET  stay resident and compile for the clients of\n"
+           "                     SOCKET, with -j JOBS of them at a time\n"
+           "    --server=SOCKET  compile on the daemon listening on SOCKET, if\n"
+           "                     there is one, defaults to $LILAC_SERVER\n"
+           "    INPUT            read source code from INPUT, each INPUT is a\n"
+           "                     program of its own\n"
            "                     if omitted or %s, reads from STDIN\n"
            "\n",
            PACKAGE_STRING,
-           output,
+           (unsigned long long) options.cacheSize,
            input
            );
 
+  static const struct option longopts[] = {
+    { "help", no_argument, nullptr, 'h' },
+    { "run",  no_argument, nullptr, 'r' },
+    { "cache-dir", required_argument, nullptr, CacheDirOption },
+    { "cache-size", required_argument, nullptr, CacheSizeOption },
+    { "daemon", required_argument, nullptr, DaemonOption },
+    { "emit", required_argument, nullptr, EmitOption },
+    { "incremental", required_argument, nullptr, IncrementalOption },
+    { "server", required_argument, nullptr, ServerOption },
+    { "time-trace", required_argument, nullptr, TimeTraceOption },
+    { nullptr, 0, nullptr, 0 }
+  };
+
   int c;
-  while ((c = getopt (argc, argv, "ho:v")) != -1)
+  while ((c = getopt_long (argc, argv, "hj:O:o:rsv", longopts, nullptr)) != -1)
     switch (c) {
     case 'h':
       cout << usage;
       return 0;
+    case 'j': {
+      char *end;
+      jobs = strtoul(optarg, &end, 10);
+      if (*optarg < '0' || *optarg > '9' || *end || jobs == 0) {
+        cerr << "invalid number of jobs: " << optarg << endl;
+        cerr << usage;
+        return 1;
+      }
+      break;
+    }
+    case 'O':
+      if (!parseOptLevel(optarg, options.optLevel)) {
+        cerr << "unknown optimization level: " << optarg << endl;
+        cerr << usage;
+        return 1;
+      }
+      break;
     case 'o':
       output = optarg;
       break;
+    case 'r':
+      options.run = true;
+      break;
+    case 's':
+      options.streaming = true;
+      break;
     case 'v':
-      verbose = true;
+      options.verbose = true;
+      break;
+    case CacheDirOption:
+      options.cacheDir = optarg;
+      break;
+    case CacheSizeOption: {
+      char *end;
+      options.cacheSize = strtoull(optarg, &end, 10);
+      if (*optarg < '0' || *optarg > '9' || *end) {
+        cerr << "invalid cache size: " << optarg << endl;
+        cerr << usage;
+        return 1;
+      }
+      break;
+    }
+    case DaemonOption:
+      daemonSocket = optarg;
+      break;
+    case EmitOption:
+      if (!parseFileType(optarg, options.fileType)) {
+        cerr << "unknown output kind: " << optarg << endl;
+        cerr << usage;
+        return 1;
+      }
+      break;
+    case IncrementalOption:
+      options.incrementalDir = optarg;
+      break;
+    case ServerOption:
+      serverSocket = optarg;
+      break;
+    case TimeTraceOption:
+      traceFile = optarg;
       break;
     default:
       cerr << usage;
       return 1;
     }
 
-  if (optind < argc) {
-    input = argv[optind];
+  // a daemon compiles -j requests at a time, by default one per CPU
+  if (daemonSocket) {
+    unsigned workers = jobs ? jobs : std::max(1u, std::thread::hardware_concurrency());
+    return serveRequests(daemonSocket, workers, options.verbose);
   }
 
-  // ---------------------------------------------------------------------------
-  // read code and tokenize it
-  // ---------------------------------------------------------------------------
+  vector<const char *> inputs(argv + optind, argv + argc);
 
-  unique_ptr<LexerResult> lexerResult;
+  if (inputs.empty())
+    inputs.push_back(input);
 
-  if (strcmp(input, "-") == 0) {
-    lexerResult = tokenize(&cin);
-  } else {
-    ifstream is(input);
-
-    if (is) {
-      lexerResult = tokenize(&is);
-      is.close();
-    } else {
-      cerr << "error opening file: " << input << endl;
-      return 1;
-    }
-  }
-
-  if (auto failure = dynamic_cast<LexerFailure*>(lexerResult.get())) {
-    cerr << "[lexer] [error] " << failure->msg << endl;
+  if (inputs.size() > 1 && (output || options.run)) {
+    cerr << "-o and --run need a single INPUT" << endl;
     return 1;
   }
 
-  LexerSuccess * lexsuccess = dynamic_cast<LexerSuccess*>(lexerResult.get());
-  vector<unique_ptr<Token> > * tokens = lexsuccess->tokens.get();
+  // the object of a single program is split to compile its parts on several
+  // threads, incremental compilation splits each program, on one thread if
+  // there are several
+  if (!options.run && options.fileType == FileType::Object &&
+      (!options.incrementalDir.empty() || (jobs > 0 && inputs.size() == 1)))
+    options.splitJobs = inputs.size() == 1 ? std::max(jobs, 1u) : 1;
 
-  if (verbose)
-    for (auto it = tokens->begin() ; it != tokens->end(); ++it) {
-      Token * token = it->get();
-      cerr << "[token] \"" << token->toString() << "\"" << endl;
-    }
+  // programs run and their time traces are in this process
+  if (options.run || traceFile || (serverSocket && !*serverSocket))
+    serverSocket = nullptr;
 
-  // ---------------------------------------------------------------------------
-  // parse the tokens to AST
-  // ---------------------------------------------------------------------------
+  unique_ptr<Trace> trace;
 
-  Parser parser(tokens);
+  if (traceFile) {
+    trace = llvm::make_unique<Trace>();
+    options.trace = trace.get();
+  }
 
-  auto parserResult = parser.parse();
+  // also when some inputs failed
+  auto writeTrace = [&](int status) {
+    string error;
 
-  if (auto failure = dynamic_cast<ParserFailure*>(parserResult.get())) {
-    cerr << "[parser] [error] " << failure->msg << endl;
-    return 1;
-  }
+    if (trace && !trace->write(traceFile, error)) {
+      cerr << "error writing time trace: " << error << endl;
+      return 1;
+    }
 
-  auto parsesuccess = dynamic_cast<ParserSuccess*>(parserResult.get());
-  auto ast = move(parsesuccess->ast);
+    if (trace)
+      trace->summarize(cerr);
 
-  if (verbose)
-    cerr << "[ast]" << endl << ast->toString() << "[/ast]" << endl;
+    return status;
+  };
 
   // ---------------------------------------------------------------------------
-  // generate LLVM IR code
+  // compile a single input
   // ---------------------------------------------------------------------------
 
-  CodeGen codegen("lilamodule", llvm::getGlobalContext());
+  if (inputs.size() == 1) {
+    Session session(options);
+    string defaultOutput = string("a.out.") + fileExtension(options.fileType);
+    string diagnostics;
 
-  auto cgresult = codegen.generateCode(move(ast));
+    int status = compileInput(serverSocket, session, inputs[0],
+                              output ? output : defaultOutput.c_str(), diagnostics);
 
-  if (auto failure = dynamic_cast<CodegenFailure*>(cgresult.get())) {
-    cerr << "[codegen] [error] " << failure->msg << endl;
-    return 1;
-  }
-
-  auto cgsuccess = dynamic_cast<CodegenSuccess*>(cgresult.get());
-  auto module = move(cgsuccess->module);
-
-  if (verbose) {
-    module->dump();
+    cerr << diagnostics;
+    return writeTrace(status);
   }
 
   // ---------------------------------------------------------------------------
-  // write object file
+  // compile several inputs on a pool of threads
   // ---------------------------------------------------------------------------
 
-  llvm::InitializeAllTargets();
-  llvm::InitializeAllTargetMCs();
-  llvm::InitializeAllAsmPrinters();
-  llvm::InitializeAllAsmParsers();
+  // outputs are named after the inputs, in the current directory as by cc -c
+  vector<string> outputs;
+  llvm::StringSet<> names;
 
-  llvm::PassRegistry *Registry = llvm::PassRegistry::getPassRegistry();
-  llvm::initializeCore(*Registry);
-  llvm::initializeCodeGen(*Registry);
-  llvm::initializeLoopStrengthReducePass(*Registry);
-  llvm::initializeLowerIntrinsicsPass(*Registry);
-  llvm::initializeUnreachableBlockElimPass(*Registry);
+  for (auto input : inputs) {
+    if (llvm::StringRef(input) == "-") {
+      cerr << "STDIN needs to be the single INPUT" << endl;
+      return 1;
+    }
 
-  llvm::Triple TheTriple(llvm::sys::getDefaultTargetTriple());
+    llvm::SmallString<128> name(llvm::sys::path::filename(input));
+    llvm::sys::path::replace_extension(name, fileExtension(options.fileType));
 
-  std::string Error;
-  const llvm::Target *TheTarget =
-    llvm::TargetRegistry::lookupTarget(TheTriple.getTriple(), Error);
+    if (!names.insert(name).second) {
+      cerr << "more than one INPUT compiles to " << name.str().str() << endl;
+      return 1;
+    }
 
-  if (!TheTarget) {
-    cerr << Error << endl;
-    return 1;
+    outputs.push_back(name.str().str());
   }
 
-  // compile for native cpu
-  std::string CPUStr = llvm::sys::getHostCPUName();
-
-  // compile for native cpu features
-  llvm::SubtargetFeatures Features;
-  llvm::StringMap<bool> HostFeatures;
-  if (llvm::sys::getHostCPUFeatures(HostFeatures))
-    for (auto &F : HostFeatures)
-      Features.AddFeature(F.first(), F.second);
-  std::string FeaturesStr = Features.getString();
-
-  llvm::CodeGenOpt::Level OLvl = llvm::CodeGenOpt::Default;
-
-  llvm::TargetOptions Options;
-
-  std::unique_ptr<llvm::TargetMachine> Target(
-    TheTarget->createTargetMachine(TheTriple.getTriple(),
-                                   CPUStr,
-                                   FeaturesStr,
-                                   Options,
-                                   llvm::Reloc::Default,
-                                   llvm::CodeModel::Default,
-                                   OLvl));
-
-  std::error_code EC;
-  auto Out = llvm::make_unique<llvm::tool_output_file>(output, EC, llvm::sys::fs::F_None);
+  std::atomic<unsigned> next(0);
+  std::atomic<unsigned> failures(0);
+  std::mutex logMutex;
 
-  llvm::legacy::PassManager PM;
-  llvm::TargetLibraryInfoImpl TLII(TheTriple);
-  PM.add(new llvm::TargetLibraryInfoWrapperPass(TLII));
+  // the output of an input is written when it is done, so that it is not
+  // interleaved with the output of the others
+  auto compileInputs = [&]() {
+    Session session(options);
 
-  if (const llvm::DataLayout *DL = Target->getDataLayout())
-    module->setDataLayout(*DL);
+    for (unsigned i = next++; i < inputs.size(); i = next++) {
+      string diagnostics;
 
-  // add features to functions of module
-  for (auto &F : *module) {
-    auto &Ctx = F.getContext();
-    llvm::AttributeSet Attrs = F.getAttributes(), NewAttrs;
+      if (compileInput(serverSocket, session, inputs[i], outputs[i].c_str(), diagnostics) != 0)
+        failures++;
 
-    if (!CPUStr.empty())
-      NewAttrs = NewAttrs.addAttribute(Ctx, llvm::AttributeSet::FunctionIndex,
-                                       "target-cpu", CPUStr);
-
-    if (!FeaturesStr.empty())
-      NewAttrs = NewAttrs.addAttribute(Ctx, llvm::AttributeSet::FunctionIndex,
-                                       "target-features", FeaturesStr);
+      if (!diagnostics.empty()) {
+        std::lock_guard<std::mutex> lock(logMutex);
+        cerr << "[input] " << inputs[i] << endl << diagnostics;
+      }
+    }
+  };
 
-    NewAttrs = Attrs.addAttributes(Ctx, llvm::AttributeSet::FunctionIndex, NewAttrs);
-    F.setAttributes(NewAttrs);
-  }
+  vector<std::thread> threads;
+  unsigned threadCount = std::min<size_t>(std::max(1u, jobs), inputs.size());
 
-  llvm::raw_pwrite_stream *OS = &Out->os();
+  for (unsigned i = 1; i < threadCount; i++)
+    threads.emplace_back(compileInputs);
 
-  if (Target->addPassesToEmitFile(PM, *OS, llvm::TargetMachine::CGFT_ObjectFile)) {
-    cerr << "error: target does not support generation of this file type" << endl;
-    return 1;
-  }
+  compileInputs();
 
-  PM.run(*module);
-
-  Out->keep();
-
-  // ---------------------------------------------------------------------------
-  // end
-  // ---------------------------------------------------------------------------
+  for (auto &thread : threads)
+    thread.join();
 
-  return 0;
+  return writeTrace(failures > 0 ? 1 : 0);
 }
@@ -0,0 +1,109 @@
+/*            __ __                                                     *\
+**     __    /_// /  ___            lila bootstrap compiler             **
+**    / /   __ / /  / _ |           (c) 2016, Christian Krause          **
+**   / /__ / // /__/ __ |                                               **
+**  /____//_//____/_/ | |                                               **
+\*                    |/                                                */
+
+#ifndef LILA_OPERATORS_H
+#define LILA_OPERATORS_H
+
+#include <cstdint>
+#include <vector>
+
+#include <llvm/ADT/StringRef.h>
+
+#include "ast.hpp"
+#include "scan.hpp"
+#include "symbol.hpp"
+
+using namespace std;
+using namespace lila::ast;
+using namespace lila::symbol;
+
+namespace lila {
+  namespace operators {
+
+    class Operator {
+    public:
+      uint8_t precedence = 0; // 0 if the symbol is no operator
+      bool rightAssoc = false;
+      BuiltinOp builtin = BuiltinOp::None;
+    };
+
+    // Infix operators by symbol. Symbols are small consecutive integers, so
+    // the table is a flat vector indexed by symbol.
+    class OperatorTable {
+    private:
+      vector<Operator> operators;
+
+      void set(Symbol op, const Operator &info) {
+        if (op >= operators.size())
+          operators.resize(op + 1);
+
+        operators[op] = info;
+      }
+
+    public:
+      explicit OperatorTable(SymbolTable &symbols) {
+        Operator add, sub, mul;
+
+        add.precedence = sub.precedence = precedenceOf("+");
+        add.builtin = BuiltinOp::Add;
+        sub.builtin = BuiltinOp::Subtract;
+
+        mul.precedence = precedenceOf("*");
+        mul.builtin = BuiltinOp::Multiply;
+
+        set(symbols.intern("+"), add);
+        set(symbols.intern("-"), sub);
+        set(symbols.intern("*"), mul);
+      }
+
+      // names starting with punctuation can be defined as infix operators
+      static bool isOperatorName(llvm::StringRef name) {
+        return !name.empty() && lexer::isPunct(name[0]);
+      }
+
+      // precedence by first character, as in Scala, from lowest to highest:
+      //   | ^ & (= !) (< >) : (+ -) (* / %) (other punctuation)
+      static uint8_t precedenceOf(llvm::StringRef name) {
+        switch (name[0]) {
+        case '|':           return 4;
+        case '^':           return 6;
+        case '&':           return 8;
+        case '=': case '!': return 10;
+        case '<': case '>': return 12;
+        case ':':           return 14;
+        case '+': case '-': return 20;
+        case '*': case '/':
+        case '%':           return 40;
+        default:            return 50;
+        }
+      }
+
+      Operator get(Symbol op) const {
+        if (op < operators.size())
+          return operators[op];
+
+        return Operator();
+      }
+
+      bool isBuiltin(Symbol op) const {
+        return get(op).builtin != BuiltinOp::None;
+      }
+
+      // user operator from "def name(a, b)", right associative if the name
+      // ends in a colon
+      void define(Symbol op, llvm::StringRef name) {
+        Operator info;
+        info.precedence = precedenceOf(name);
+        info.rightAssoc = name.back() == ':';
+        set(op, info);
+      }
+    };
+
+  }
+}
+
+#endif
@@ -10,191 +10,191 @@
 namespace lila {
   namespace parser {
 
-    unique_ptr<ExprAST> Parser::parseBlock() {
-      auto body = llvm::make_unique<vector<unique_ptr<ASTNode> > >();
-      ostringstream oss;
-      oss << "anon" << anonindex++;
-      addScope(oss.str());
-      unique_ptr<ASTNode> curast;
+    Node Parser::parseBlock() {
+      vector<Node> body;
+      Node curast;
       indent++;
 
       while (nextToken()) {
-        if (dynamic_cast<BlockClose*>(curtok)) {
+        if (cur.kind == TokenKind::BlockClose)
           break;
-        } else if (dynamic_cast<NewlineToken*>(curtok)) {
+
+        switch (cur.kind) {
+        case TokenKind::Newline:
           continue;
-        } else if (dynamic_cast<DefToken*>(curtok)) {
+        case TokenKind::Def:
           curast = parseDef();
-        } else if (dynamic_cast<ValueToken*>(curtok)) {
+          break;
+        case TokenKind::Value:
           curast = parseValue();
-        } else {
+          break;
+        default:
           curast = parseExpression();
+          break;
         }
 
-        if (!curast) return nullptr;
+        if (!curast) return Node();
 
-        body->push_back(move(curast));
+        body.push_back(curast);
 
-        if (dynamic_cast<BlockClose*>(curtok)) {
+        if (cur.kind == TokenKind::BlockClose)
           break;
-        }
       }
 
-      if (!dynamic_cast<BlockClose*>(curtok)) {
+      if (cur.kind != TokenKind::BlockClose) {
         error = "expected '}'";
-        return nullptr;
+        return Node();
       }
 
       nextToken(); // eat }
 
-      if (!dynamic_cast<ExprAST*>(body->back().get())) {
+      if (body.empty() || !body.back().isExpr()) {
         error = "block does not end in expression";
-        return nullptr;
+        return Node();
       }
 
-      if (body->size() == 1) {
-        // safe cast because last piece of body is expression (checked before)
-        ExprAST * e = dynamic_cast<ExprAST*>(body->back().release());
-        auto expr = unique_ptr<ExprAST>(e);
+      if (body.size() == 1) {
+        // last piece of body is expression (checked before)
         indent--;
-        removeScope();
-        return expr;
+        return body.back();
       } else {
-        auto block = llvm::make_unique<BlockAST>(move(body), indent);
+        Node block = ast->addBlock(ast->addNodes(body), indent);
         indent--;
-        removeScope();
-        return move(block);
+        return block;
       }
     }
 
-    unique_ptr<ExprAST> Parser::parseNumberExpr(NumberToken* tok) {
-      double number = tok->value;
+    Node Parser::parseNumberExpr() {
+      double number = cur.value.number;
       nextToken();
-      auto numberast = llvm::make_unique<NumberExprAST>(number);
-      return move(numberast);
+      return ast->addNumber(number);
     }
 
-    unique_ptr<ExprAST> Parser::parseBinOpRHS(unique_ptr<ExprAST> lhs, int prec) {
-      while (curtok) {
-        // expecting some op token
-        if (auto op = dynamic_cast<OtherToken*>(curtok)) {
-          int opprec = getPrecedence(op->name);
+    Node Parser::parseBinOpRHS(Node lhs, int prec) {
+      while (cur.kind != TokenKind::End) {
+        switch (cur.kind) {
+        case TokenKind::Other: { // expecting some op token
+          Symbol op = cur.value.symbol;
+          Operator info = operators.get(op);
+          int opprec = info.precedence;
+
+          if (!opprec) {
+            error = "unknown operator: " + symbols.str(op);
+            return Node();
+          }
 
           if (opprec < prec)
             return lhs;
 
           if (!nextToken()) {
             error = "expected token after operation";
-            return nullptr;
+            return Node();
           }
 
           // parse primary expression after the operator
           auto rhs = parsePrimary();
           if (!rhs)
-            return nullptr;
-
-          if (!curtok)
-            return llvm::make_unique<BinaryExprAST>(op->name, move(lhs), move(rhs));
+            return Node();
 
-          // if op binds less tightly with rhs than op after rhs, let
-          // the pending op take rhs as its lhs
-          if (auto nextop = dynamic_cast<OtherToken*>(curtok)) {
-            int nextprec = getPrecedence(nextop->name);
+          switch (cur.kind) {
+          case TokenKind::Other: {
+            // if op binds less tightly with rhs than op after rhs, or as
+            // tightly and op is right associative, let the pending op take
+            // rhs as its lhs
+            int nextprec = operators.get(cur.value.symbol).precedence;
 
-            if (opprec < nextprec) {
-              rhs = parseBinOpRHS(move(rhs), opprec + 1);
+            if (opprec < nextprec || (opprec == nextprec && info.rightAssoc)) {
+              rhs = parseBinOpRHS(rhs, info.rightAssoc ? opprec : opprec + 1);
 
               if (!rhs)
-                return nullptr;
+                return Node();
             }
 
             // Merge lhs/rhs.
-            lhs = llvm::make_unique<BinaryExprAST>(op->name, move(lhs), move(rhs));
-          } else if (dynamic_cast<CommaToken*>(curtok)) {
-            return llvm::make_unique<BinaryExprAST>(op->name, move(lhs), move(rhs));
-          } else if (dynamic_cast<NewlineToken*>(curtok)) {
-            return llvm::make_unique<BinaryExprAST>(op->name, move(lhs), move(rhs));
-          } else if (dynamic_cast<BlockClose*>(curtok)) {
-            return llvm::make_unique<BinaryExprAST>(op->name, move(lhs), move(rhs));
-          } else if (dynamic_cast<ParenClose*>(curtok)) {
-            return llvm::make_unique<BinaryExprAST>(op->name, move(lhs), move(rhs));
+            lhs = ast->addBinary(op, info.builtin, lhs, rhs);
+            break;
+          }
+          case TokenKind::End:
+          case TokenKind::Comma:
+          case TokenKind::Newline:
+          case TokenKind::BlockClose:
+          case TokenKind::ParenClose:
+            return ast->addBinary(op, info.builtin, lhs, rhs);
+          default:
+            error = "unknown token \"" + curstr() + "\" when expecting an operation";
+            return Node();
           }
 
-        } else if (dynamic_cast<CommaToken*>(curtok)) {
-          return lhs;
-        } else if (dynamic_cast<NewlineToken*>(curtok)) {
-          return lhs;
-        } else if (dynamic_cast<BlockClose*>(curtok)) {
-          return lhs;
-        } else if (dynamic_cast<ParenClose*>(curtok)) {
+          break;
+        }
+        case TokenKind::Comma:
+        case TokenKind::Newline:
+        case TokenKind::BlockClose:
+        case TokenKind::ParenClose:
           return lhs;
-        } else {
-          error = "unknown token \"" + curtok->toString() + "\" when expecting an operation";
-          return nullptr;
+        default:
+          error = "unknown token \"" + curstr() + "\" when expecting an operation";
+          return Node();
         }
       }
 
       return lhs;
     }
 
-    unique_ptr<ExprAST> Parser::parseParenExpr() {
+    Node Parser::parseParenExpr() {
       nextToken(); // eat (
       auto expr = parseExpression();
       if (!expr) {
-        return nullptr;
+        return Node();
       }
 
-      if (dynamic_cast<ParenClose*>(curtok)) {
+      if (cur.kind == TokenKind::ParenClose) {
         nextToken(); // eat )
         return expr;
       } else {
         error = "expected ')'";
-        return nullptr;
+        return Node();
       }
     }
 
-    unique_ptr<ExprAST> Parser::parsePrimary() {
-      if (auto t = dynamic_cast<NumberToken*>(curtok)) {
-        return parseNumberExpr(t);
-      } else if (dynamic_cast<BlockOpen*>(curtok)) {
+    Node Parser::parsePrimary() {
+      switch (cur.kind) {
+      case TokenKind::Number:
+        return parseNumberExpr();
+      case TokenKind::BlockOpen:
         return parseBlock();
-      } else if (dynamic_cast<ParenOpen*>(curtok)) {
+      case TokenKind::ParenOpen:
         return parseParenExpr();
-      } else if (auto t = dynamic_cast<OtherToken*>(curtok)) {
-        if (existsScopedValue(t->name)) {
-          return parseIdentifier(t->name);
-        } else {
-          error = "unknown identifier: " + curtok->toString();
-          return nullptr;
-        }
-      } else {
-        error = "unknown token \"" + curtok->toString() + "\" when expecting primary";
-        return nullptr;
+      case TokenKind::Other:
+        return parseIdentifier(cur.value.symbol);
+      default:
+        error = "unknown token \"" + curstr() + "\" when expecting primary";
+        return Node();
       }
     }
 
-    unique_ptr<ExprAST> Parser::parseIdentifier(string name) {
-      auto args = llvm::make_unique<vector<unique_ptr<ExprAST> > >();
+    Node Parser::parseIdentifier(Symbol name) {
+      vector<Node> args;
 
       nextToken();
 
-      if (dynamic_cast<ParenOpen*>(curtok)) {
+      if (cur.kind == TokenKind::ParenOpen) {
         nextToken(); // eat "(" token
         bool expectarg = true;
 
-        while (curtok) {
-          if (dynamic_cast<ParenClose*>(curtok)) {
+        while (cur.kind != TokenKind::End) {
+          if (cur.kind == TokenKind::ParenClose) {
             if (expectarg) {
               error = "expecting an argument";
-              return nullptr;
+              return Node();
             } else {
               break;
             }
-          } else if (dynamic_cast<CommaToken*>(curtok)) {
+          } else if (cur.kind == TokenKind::Comma) {
             nextToken();
             if (expectarg) {
               error = "expecting an argument";
-              return nullptr;
+              return Node();
             } else {
               expectarg = true;
             }
@@ -203,13 +203,13 @@ namespace lila {
               auto expr = parseExpression();
               if (!expr) {
                 error = "expected expression as argument: " + error;
-                return nullptr;
+                return Node();
               }
-              args->push_back(move(expr));
+              args.push_back(expr);
               expectarg = false;
             } else {
               error = "didn't expect another argument";
-              return nullptr;
+              return Node();
             }
           }
         }
@@ -217,37 +217,36 @@ namespace lila {
         nextToken(); // eat ")" token
       }
 
-      auto ast = llvm::make_unique<CallAST>(name, move(args));
-      return move(ast);
+      return ast->addCall(name, ast->addNodes(args));
     }
 
-    unique_ptr<ExprAST> Parser::parseExpression() {
+    Node Parser::parseExpression() {
       auto lhs = parsePrimary();
 
       if (!lhs)
-        return nullptr;
+        return Node();
 
-      return parseBinOpRHS(move(lhs), 0);
+      return parseBinOpRHS(lhs, 0);
     }
 
     // val name = expr
-    unique_ptr<ValueAST> Parser::parseValue() {
-      string name;
+    Node Parser::parseValue() {
+      Symbol name;
 
       nextToken(); // eat "val" token
 
-      if (auto t = dynamic_cast<OtherToken*>(curtok)) {
-        name = t->name;
+      if (cur.kind == TokenKind::Other) {
+        name = cur.value.symbol;
       } else {
         error = "expected value name";
-        return nullptr;
+        return Node();
       }
 
       nextToken(); // eat name of value token
 
-      if (!dynamic_cast<AssignmentToken*>(curtok)) {
+      if (cur.kind != TokenKind::Assignment) {
         error = "expected \"=\"";
-        return nullptr;
+        return Node();
       }
 
       nextToken(); // eat "=" token
@@ -256,95 +255,86 @@ namespace lila {
 
       if (!expr) {
         error = "expected expression: " + error;
-        return nullptr;
-      }
-
-      if (existsCurrentScope(name)) {
-        error = name + " is already defined";
-        return nullptr;
+        return Node();
       }
 
-      vector<string> emptyargs;
-      addScopedValue(name, emptyargs);
-      auto ast = llvm::make_unique<ValueAST>(name, move(expr));
-      return ast;
+      return ast->addValue(name, expr);
     }
 
     // def name = expr
-    unique_ptr<DefAST> Parser::parseDef() {
-      string name;
-      vector<string> args;
+    Node Parser::parseDef() {
+      Symbol name;
+      vector<Symbol> args;
 
       nextToken(); // eat "def" token
 
-      if (auto t = dynamic_cast<OtherToken*>(curtok)) {
-        name = t->name;
-        addScope(name);
-
-        if (existsCurrentScope(name)) {
-          error = name + " is already defined";
-          return nullptr;
-        }
-
+      if (cur.kind == TokenKind::Other) {
+        name = cur.value.symbol;
       } else {
         error = "expected def name";
-        return nullptr;
+        return Node();
+      }
+
+      bool isOperator = OperatorTable::isOperatorName(symbols.name(name));
+
+      if (isOperator && operators.isBuiltin(name)) {
+        error = "can't redefine built-in operator " + symbols.str(name);
+        return Node();
       }
 
       nextToken(); // eat name of value token
 
-      if (dynamic_cast<ParenOpen*>(curtok)) {
+      if (cur.kind == TokenKind::ParenOpen) {
         nextToken(); // eat "(" token
         bool expectarg = true;
 
-        while (curtok) {
-          if (dynamic_cast<ParenClose*>(curtok)) {
+        while (cur.kind != TokenKind::End) {
+          switch (cur.kind) {
+          case TokenKind::ParenClose:
             if (expectarg) {
               error = "expecting an argument";
-              return nullptr;
-            } else {
-              break;
+              return Node();
             }
-          } else if (auto t = dynamic_cast<OtherToken*>(curtok)) {
+            break;
+          case TokenKind::Other:
             if (expectarg) {
-              string name = t->name;
-
-              for (auto it = args.begin() ; it != args.end(); ++it)
-                if (name == *it) {
-                  error = name + " is already defined as another argument";
-                  return nullptr;
-                }
-
-              vector<string> emptyargs;
-              addScopedValue(name, emptyargs);
-
-              args.push_back(name);
+              args.push_back(cur.value.symbol);
               expectarg = false;
             } else {
               error = "didn't expect another argument";
-              return nullptr;
+              return Node();
             }
-          } else if (dynamic_cast<CommaToken*>(curtok)) {
+            break;
+          case TokenKind::Comma:
             if (expectarg) {
               error = "expecting an argument";
-              return nullptr;
+              return Node();
             } else {
               expectarg = true;
             }
-          } else {
+            break;
+          default:
             error = "expected arguments or end of arguments, i.e. \")\"";
-            return nullptr;
+            return Node();
           }
 
+          if (cur.kind == TokenKind::ParenClose)
+            break;
+
           nextToken();
         }
 
         nextToken(); // eat ")" token
       }
 
-      if (!dynamic_cast<AssignmentToken*>(curtok)) {
+      if (isOperator && args.size() != 2) {
+        error = "operator " + symbols.str(name) + " must take two arguments";
+        return Node();
+      }
+
+      if (cur.kind != TokenKind::Assignment) {
         error = "expected \"=\"";
-        return nullptr;
+        return Node();
       }
 
       nextToken(); // eat "=" token
@@ -353,75 +343,109 @@ namespace lila {
 
       if (!expr) {
         error = "expected expression: " + error;
-        return nullptr;
+        return Node();
       }
 
-      auto ast = llvm::make_unique<DefAST>(name, args, move(expr));
-      removeScope();
-      addScopedValue(name, args);
-      return ast;
+      if (isOperator)
+        operators.define(name, symbols.name(name));
+
+      return ast->addDef(name, ast->addSymbols(args), expr);
     }
 
-    unique_ptr<ExprAST> Parser::parseTopLevelBlock() {
-      auto body = llvm::make_unique<vector<unique_ptr<ASTNode> > >();
-      ostringstream oss;
-      oss << "anon" << anonindex++;
-      addScope(oss.str());
-      unique_ptr<ASTNode> curast;
+    Node Parser::parseTopLevelBlock() {
+      vector<Node> body;
+      Node curast;
       indent++;
 
-      while (curtok) {
-        if (dynamic_cast<NewlineToken*>(curtok)) {
+      while (cur.kind != TokenKind::End) {
+        switch (cur.kind) {
+        case TokenKind::Newline:
           nextToken();
           continue;
-        } else if (dynamic_cast<DefToken*>(curtok)) {
+        case TokenKind::Def:
           curast = parseDef();
-        } else if (dynamic_cast<ValueToken*>(curtok)) {
+          break;
+        case TokenKind::Value:
           curast = parseValue();
-        } else {
+          break;
+        default:
           curast = parseExpression();
+          break;
         }
 
         if (curast) {
-          body->push_back(move(curast));
+          body.push_back(curast);
         } else {
           error = "error parsing top level block: " + error;
-          return nullptr;
+          return Node();
         }
 
         nextToken();
       }
 
-      if (!dynamic_cast<ExprAST*>(body->back().get())) {
+      if (!input && !body.back().isExpr()) {
         error = "top level block does not end in expression";
-        return nullptr;
+        return Node();
       }
 
-      auto block = llvm::make_unique<BlockAST>(move(body), indent);
+      Node block = ast->addBlock(ast->addNodes(body), indent);
       indent--;
-      removeScope();
-      return move(block);
+      return block;
     }
 
-    unique_ptr<ParserResult> Parser::parse() {
-      unique_ptr<ASTNode> curast;
+    bool Parser::parseTokens() {
+      Node curast;
       pos = 0;
 
       while (nextToken()) {
-        if (dynamic_cast<NewlineToken*>(curtok)) {
+        if (cur.kind == TokenKind::Newline) {
           continue;
         } else {
           curast = parseTopLevelBlock();
         }
 
         if (!curast) {
-          auto failure = llvm::make_unique<ParserFailure>(error);
-          return move(failure);
+          if (lexerError())
+            error = lexer->error;
+          return false;
         }
       }
 
-      auto success = llvm::make_unique<ParserSuccess>(move(curast));
+      // in streaming mode a lexer error ends the token stream early, which
+      // must not be mistaken for the end of the source
+      if (lexerError()) {
+        error = lexer->error;
+        return false;
+      }
+
+      ast->root = curast;
+      return true;
+    }
+
+    unique_ptr<ParserResult> Parser::parse() {
+      auto program = llvm::make_unique<AST>();
+      ast = program.get();
+      input = false;
+
+      if (!parseTokens()) {
+        auto failure = llvm::make_unique<ParserFailure>(error);
+        return move(failure);
+      }
+
+      auto success = llvm::make_unique<ParserSuccess>(move(program));
+      return move(success);
+    }
+
+    unique_ptr<ParserResult> Parser::parseInput(AST &session) {
+      ast = &session;
+      input = true;
+
+      if (!parseTokens()) {
+        auto failure = llvm::make_unique<ParserFailure>(error);
+        return move(failure);
+      }
 
+      auto success = llvm::make_unique<ParserSuccess>(nullptr);
       return move(success);
     }
   }
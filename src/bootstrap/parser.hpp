@@ -8,154 +8,124 @@
 #ifndef LILA_PARSER_H
 #define LILA_PARSER_H
 
-#include <map>
-
 #include "ast.hpp"
 #include "lexer.hpp"
+#include "operators.hpp"
 #include "util.hpp"
 
 using namespace lila::ast;
 using namespace lila::lexer;
+using namespace lila::operators;
 
 namespace lila {
   namespace parser {
 
     class ParserResult {
     public:
+      const bool success;
+      explicit ParserResult(bool success) : success(success) {}
       virtual ~ParserResult() {}
     };
 
     class ParserSuccess : public ParserResult {
     public:
-      unique_ptr<ASTNode> ast;
-      explicit ParserSuccess(unique_ptr<ASTNode> ast) : ast(move(ast)) {}
+      unique_ptr<AST> ast;
+      explicit ParserSuccess(unique_ptr<AST> ast)
+        : ParserResult(true), ast(move(ast)) {}
+      static bool classof(const ParserResult *result) {
+        return result->success;
+      }
     };
 
     class ParserFailure : public ParserResult {
     public:
       string msg;
-      explicit ParserFailure(string msg) : msg(msg) {}
-    };
-
-    class ParserValue {
-    public:
-      string name;
-      vector<string> args;
-      explicit ParserValue(string name, vector<string> args)
-        : name(name), args(args) {}
+      explicit ParserFailure(string msg) : ParserResult(false), msg(msg) {}
+      static bool classof(const ParserResult *result) {
+        return !result->success;
+      }
     };
 
     class Parser {
     private:
-      unsigned int anonindex = 0;
-      vector<unique_ptr<Token> >* tokens;
-      map<string, int> operatorPrecendences;
-      Token * curtok;
-      vector<unique_ptr<Token> >::size_type pos = 0;
+      // tokens come either from a token stream or straight from a lexer
+      TokenStream* tokens = nullptr;
+      Lexer* lexer = nullptr;
+      llvm::StringRef source;
+      ostream* echo = nullptr;
+      SymbolTable &symbols;
+      OperatorTable &operators;
+      Token cur = Token { TokenKind::End, 0, 0, 0 };
+      size_t pos = 0;
       string error;
       int indent = 0;
-
-      int getPrecedence(string op) {
-        int precedence = operatorPrecendences[op];
-
-        if (precedence <= 0)
-          return 0;
-
-        return precedence;
-      }
+      AST *ast = nullptr; // nodes are added here while parsing
+      bool input = false;
 
       int nextToken() {
-        auto size = tokens->size();
+        if (lexer) {
+          if (!lexer->next(cur)) {
+            cur.kind = TokenKind::End;
+            return 0;
+          }
+        } else {
+          if (pos >= tokens->size()) {
+            cur.kind = TokenKind::End;
+            return 0;
+          }
 
-        if (pos >= size) {
-          curtok = NULL;
-          return 0;
+          cur = tokens->get(pos++);
         }
 
-        curtok = tokens->at(pos++).get();
+        if (echo)
+          *echo << "[token] \"" << toString(cur, source) << "\"" << endl;
 
         return 1;
       }
 
-      vector<string> curscope;
-      map<string, vector<ParserValue> > scoped_values;
-
-      void removeScope() {
-        curscope.pop_back();
-      }
-
-      string scopestr() {
-        return util::mkString(curscope, ".");
-      }
-
-      void addScope(string level) {
-        // first add to curscope
-        curscope.push_back(level);
-
-        // second add empty values to scope map
-        vector<ParserValue > values;
-        scoped_values[scopestr()] = values;
+      bool lexerError() {
+        return lexer && lexer->failed();
       }
 
-      void addScopedValue(string name, vector<string> args) {
-        string scope = scopestr();
-
-        ParserValue value(name, args);
-
-        vector<ParserValue> values = scoped_values[scope];
-        values.push_back(value);
-
-        scoped_values[scope] = values;
+      string curstr() {
+        return toString(cur, source);
       }
 
-      bool existsScopedValue(string name) {
-        // search from current scope outwards
-        for (int i = curscope.size(); i >= 0; i--) {
-          ostringstream oss;
-          for (int j = 0; j < i; j++) {
-            oss << curscope[j];
-            if (j < (i - 1)) oss << '.';
-          }
-
-          string scope = oss.str();
-
-          vector<ParserValue> values = scoped_values[scope];
 
-          for (auto it = values.begin() ; it != values.end(); ++it)
-            if (name == it->name) return true;
-        }
-
-        return false;
-      }
-
-      bool existsCurrentScope(string name) {
-        vector<ParserValue> values = scoped_values[scopestr()];
+      Node parseExpression();
+      Node parseNumberExpr();
+      Node parseParenExpr();
+      Node parsePrimary();
+      Node parseBinOpRHS(Node lhs, int prec);
+      Node parseIdentifier(Symbol name);
+      Node parseBlock();
+      Node parseTopLevelBlock();
+      Node parseValue();
+      Node parseDef();
 
-        for (auto it = values.begin() ; it != values.end(); ++it)
-          if (name == it->name) return true;
+      bool parseTokens();
 
-        return false;
-      }
+    public:
+      explicit Parser(TokenStream* tokens, SymbolTable &symbols, OperatorTable &operators)
+        : tokens(tokens), source(tokens->source), symbols(symbols), operators(operators) {}
 
-      unique_ptr<ExprAST> parseExpression();
-      unique_ptr<ExprAST> parseNumberExpr(NumberToken* tok);
-      unique_ptr<ExprAST> parseParenExpr();
-      unique_ptr<ExprAST> parsePrimary();
-      unique_ptr<ExprAST> parseBinOpRHS(unique_ptr<ExprAST> lhs, int prec);
-      unique_ptr<ExprAST> parseIdentifier(string name);
-      unique_ptr<ExprAST> parseBlock();
-      unique_ptr<ExprAST> parseTopLevelBlock();
-      unique_ptr<ValueAST> parseValue();
-      unique_ptr<DefAST> parseDef();
+      // streaming mode: tokens are lexed as the parser consumes them, so only
+      // the current token is held in memory
+      explicit Parser(Lexer* lexer, SymbolTable &symbols, OperatorTable &operators)
+        : lexer(lexer), source(lexer->getSource()), symbols(symbols), operators(operators) {}
 
-    public:
-      explicit Parser(vector<unique_ptr<Token> >* tokens) : tokens(tokens) {
-        operatorPrecendences["+"] = 20;
-        operatorPrecendences["-"] = 20;
-        operatorPrecendences["*"] = 40;
+      // print every token as it is consumed
+      void echoTokens(ostream* os) {
+        echo = os;
       }
 
       unique_ptr<ParserResult> parse();
+
+      // parses one input of an interactive session into the AST of the
+      // session, whose root is then the block of the input, or no node for
+      // an empty input. Unlike a program, an input need not end in an
+      // expression. The AST of a success is empty.
+      unique_ptr<ParserResult> parseInput(AST &session);
     };
 
   }
@@ -0,0 +1,212 @@
+/*            __ __                                                     *\
+**     __    /_// /  ___            lila bootstrap compiler             **
+**    / /   __ / /  / _ |           (c) 2016, Christian Krause          **
+**   / /__ / // /__/ __ |                                               **
+**  /____//_//____/_/ | |                                               **
+\*                    |/                                                */
+
+#include "resolver.hpp"
+
+namespace lila {
+  namespace resolver {
+
+    bool Resolver::declare(Symbol name, bool def, uint32_t &slot) {
+      uint32_t depth = frames.size() - 1;
+      auto &bindings = visible[name];
+
+      // an input of a session may redefine what earlier inputs declared,
+      // but not what it declared itself
+      bool redefinition =
+        session && depth == 0 && !bindings.empty() && bindings.back().slot < inputSlots;
+
+      if (!bindings.empty() && bindings.back().depth == depth && !redefinition) {
+        error = symbols.str(name) + " is already defined";
+        return false;
+      }
+
+      Binding binding;
+      binding.depth = depth;
+      binding.slot = frames.back().size();
+      binding.def = def;
+
+      bindings.push_back(binding);
+      frames.back().push_back(name);
+
+      slot = binding.slot;
+      return true;
+    }
+
+    bool Resolver::lookup(Symbol name, Binding &binding) {
+      lookups++;
+
+      auto &bindings = visible[name];
+
+      if (bindings.empty()) {
+        error = "unknown identifier: " + symbols.str(name);
+        return false;
+      }
+
+      binding = bindings.back();
+      return true;
+    }
+
+    bool Resolver::resolveExpr(Node node) {
+      switch (node.kind()) {
+      case ASTKind::Number:
+        return true;
+      case ASTKind::Call:
+        return resolveCall(ast->call(node));
+      case ASTKind::BinaryExpr:
+        return resolveBinary(ast->binary(node));
+      case ASTKind::Block:
+        return resolveBlock(ast->block(node));
+      default:
+        error = "can't handle expression ast";
+        return false;
+      }
+    }
+
+    bool Resolver::resolveBlock(BlockNode &block) {
+      openFrame();
+
+      if (!resolveBody(block))
+        return false;
+
+      closeFrame();
+      return true;
+    }
+
+    bool Resolver::resolveBody(BlockNode &block) {
+      for (auto node : ast->nodeList(block.body)) {
+        switch (node.kind()) {
+        case ASTKind::Value:
+          if (!resolveValue(ast->value(node))) return false;
+          break;
+        case ASTKind::Def:
+          if (!resolveDef(ast->def(node))) return false;
+          break;
+        default:
+          if (!resolveExpr(node)) return false;
+          break;
+        }
+      }
+
+      block.frameSize = frames.back().size();
+      return true;
+    }
+
+    bool Resolver::resolveBinary(BinaryNode &binary) {
+      // user operators are calls of the def in scope
+      if (binary.builtin == BuiltinOp::None) {
+        if (!lookup(binary.op, binary.binding))
+          return false;
+
+        if (!binary.binding.def) {
+          error = symbols.str(binary.op) + " is not an operator";
+          return false;
+        }
+      }
+
+      return resolveExpr(binary.lhs) && resolveExpr(binary.rhs);
+    }
+
+    bool Resolver::resolveCall(CallNode &call) {
+      if (!lookup(call.name, call.binding))
+        return false;
+
+      for (auto arg : ast->nodeList(call.args))
+        if (!resolveExpr(arg)) return false;
+
+      return true;
+    }
+
+    bool Resolver::resolveValue(ValueNode &value) {
+      // the value is not visible in its own definition
+      if (!resolveExpr(value.expr))
+        return false;
+
+      return declare(value.name, false, value.slot);
+    }
+
+    bool Resolver::resolveDef(DefNode &def) {
+      openFrame();
+
+      for (auto arg : ast->symbolList(def.args)) {
+        uint32_t slot;
+        if (!declare(arg, false, slot)) {
+          error = symbols.str(arg) + " is already defined as another argument";
+          return false;
+        }
+      }
+
+      // the def is not visible in its own body
+      if (!resolveExpr(def.body))
+        return false;
+
+      closeFrame();
+
+      return declare(def.name, true, def.slot);
+    }
+
+    unique_ptr<ResolverResult> Resolver::resolve(unique_ptr<AST> ast) {
+      frames.clear();
+      visible.clear();
+      visible.resize(symbols.size());
+      session = false;
+
+      if (!ast->root || ast->root.kind() != ASTKind::Block) {
+        auto failure = llvm::make_unique<ResolverFailure>("can't handle ast");
+        return move(failure);
+      }
+
+      this->ast = ast.get();
+
+      if (!resolveBlock(ast->block(ast->root))) {
+        auto failure = llvm::make_unique<ResolverFailure>(error);
+        return move(failure);
+      }
+
+      auto success = llvm::make_unique<ResolverSuccess>(move(ast));
+      return move(success);
+    }
+
+    unique_ptr<ResolverResult> Resolver::resolveInput(AST &session) {
+      if (!this->session) {
+        frames.clear();
+        visible.clear();
+        openFrame();
+        this->session = true;
+      }
+
+      // new symbols of this input
+      visible.resize(symbols.size());
+
+      if (!session.root || session.root.kind() != ASTKind::Block) {
+        auto failure = llvm::make_unique<ResolverFailure>("can't handle ast");
+        return move(failure);
+      }
+
+      this->ast = &session;
+      size_t declared = frames.front().size();
+      inputSlots = declared;
+
+      if (!resolveBody(ast->block(ast->root))) {
+        // forget everything of this input
+        while (frames.size() > 1)
+          closeFrame();
+
+        auto &names = frames.front();
+        for (size_t i = names.size(); i > declared; i--)
+          visible[names[i - 1]].pop_back();
+        names.resize(declared);
+
+        auto failure = llvm::make_unique<ResolverFailure>(error);
+        return move(failure);
+      }
+
+      auto success = llvm::make_unique<ResolverSuccess>(nullptr);
+      return move(success);
+    }
+
+  }
+}
@@ -0,0 +1,112 @@
+/*            __ __                                                     *\
+**     __    /_// /  ___            lila bootstrap compiler             **
+**    / /   __ / /  / _ |           (c) 2016, Christian Krause          **
+**   / /__ / // /__/ __ |                                               **
+**  /____//_//____/_/ | |                                               **
+\*                    |/                                                */
+
+#ifndef LILA_RESOLVER_H
+#define LILA_RESOLVER_H
+
+#include <memory>
+#include <vector>
+
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/Support/Casting.h>
+
+#include "ast.hpp"
+
+using namespace lila::ast;
+
+namespace lila {
+  namespace resolver {
+
+    class ResolverResult {
+    public:
+      const bool success;
+      explicit ResolverResult(bool success) : success(success) {}
+      virtual ~ResolverResult() {}
+    };
+
+    class ResolverSuccess : public ResolverResult {
+    public:
+      unique_ptr<AST> ast;
+      explicit ResolverSuccess(unique_ptr<AST> ast)
+        : ResolverResult(true), ast(move(ast)) {}
+      static bool classof(const ResolverResult *result) {
+        return result->success;
+      }
+    };
+
+    class ResolverFailure : public ResolverResult {
+    public:
+      string msg;
+      explicit ResolverFailure(string msg) : ResolverResult(false), msg(msg) {}
+      static bool classof(const ResolverResult *result) {
+        return !result->success;
+      }
+    };
+
+    // Binds every name to its declaration. Blocks and defs open a frame, vals
+    // and defs take the next slot of the frame they are declared in, def
+    // arguments the slots of the def's own frame. Code generation then finds
+    // a name at frames[depth][slot] without any lookup by name.
+    class Resolver {
+    private:
+      SymbolTable &symbols;
+      AST *ast = nullptr;
+      string error;
+
+      // names declared in each open frame, in slot order
+      vector<vector<Symbol> > frames;
+
+      // visible bindings of each symbol, innermost last
+      vector<vector<Binding> > visible;
+
+      // interactive session, see resolveInput
+      bool session = false;
+
+      // slots of the top level frame taken by earlier inputs
+      uint32_t inputSlots = 0;
+
+      void openFrame() {
+        frames.push_back(vector<Symbol>());
+      }
+
+      void closeFrame() {
+        for (auto name : frames.back())
+          visible[name].pop_back();
+
+        frames.pop_back();
+      }
+
+      bool declare(Symbol name, bool def, uint32_t &slot);
+      bool lookup(Symbol name, Binding &binding);
+
+      bool resolveExpr(Node node);
+      bool resolveBlock(BlockNode &block);
+      bool resolveBody(BlockNode &block);
+      bool resolveBinary(BinaryNode &binary);
+      bool resolveCall(CallNode &call);
+      bool resolveValue(ValueNode &value);
+      bool resolveDef(DefNode &def);
+
+    public:
+      // names looked up so far
+      uint64_t lookups = 0;
+
+      explicit Resolver(SymbolTable &symbols) : symbols(symbols) {}
+
+      unique_ptr<ResolverResult> resolve(unique_ptr<AST> ast);
+
+      // Resolves the root block of one input of an interactive session. All
+      // inputs share the top level frame, which stays open, so an input
+      // sees the vals and defs of earlier inputs at their slots and may
+      // redefine them. The AST of a success is empty.
+      unique_ptr<ResolverResult> resolveInput(AST &session);
+    };
+
+  }
+}
+
+#endif
@@ -0,0 +1,250 @@
+/*            __ __                                                     *\
+**     __    /_// /  ___            lila bootstrap compiler             **
+**    / /   __ / /  / _ |           (c) 2016, Christian Krause          **
+**   / /__ / // /__/ __ |                                               **
+**  /____//_//____/_/ | |                                               **
+\*                    |/                                                */
+
+#include "scan.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LILA_SCAN_X86
+#endif
+
+#define LILA_AVX2 __attribute__((target("avx2")))
+
+namespace lila {
+  namespace lexer {
+
+    namespace {
+
+      // -----------------------------------------------------------------------
+      // character classes, as vectors of 0xff (member) / 0x00 (non member)
+      // -----------------------------------------------------------------------
+
+#ifdef LILA_SCAN_X86
+#ifdef __SSE2__
+      // c - lo <= hi - lo, unsigned
+      inline __m128i inRange(__m128i x, char lo, char hi) {
+        __m128i t = _mm_sub_epi8(x, _mm_set1_epi8(lo));
+        return _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(hi - lo)), t);
+      }
+#endif
+
+      LILA_AVX2 inline __m256i inRange(__m256i x, char lo, char hi) {
+        __m256i t = _mm256_sub_epi8(x, _mm256_set1_epi8(lo));
+        return _mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8(hi - lo)), t);
+      }
+#endif
+
+      struct DigitRun {
+        static bool member(unsigned char c) {
+          return isDigit(c);
+        }
+
+#ifdef LILA_SCAN_X86
+#ifdef __SSE2__
+        static __m128i member(__m128i x) {
+          return inRange(x, '0', '9');
+        }
+#endif
+
+        LILA_AVX2 static __m256i member(__m256i x) {
+          return inRange(x, '0', '9');
+        }
+#endif
+      };
+
+      struct AlnumRun {
+        static bool member(unsigned char c) {
+          return isDigit(c) || isAlpha(c);
+        }
+
+#ifdef LILA_SCAN_X86
+#ifdef __SSE2__
+        static __m128i member(__m128i x) {
+          __m128i lower = _mm_or_si128(x, _mm_set1_epi8(0x20));
+          return _mm_or_si128(inRange(x, '0', '9'), inRange(lower, 'a', 'z'));
+        }
+#endif
+
+        LILA_AVX2 static __m256i member(__m256i x) {
+          __m256i lower = _mm256_or_si256(x, _mm256_set1_epi8(0x20));
+          return _mm256_or_si256(inRange(x, '0', '9'), inRange(lower, 'a', 'z'));
+        }
+#endif
+      };
+
+      struct PunctRun {
+        static bool member(unsigned char c) {
+          return isPunct(c);
+        }
+
+#ifdef LILA_SCAN_X86
+#ifdef __SSE2__
+        static __m128i member(__m128i x) {
+          // visible characters that are not alphanumeric
+          return _mm_andnot_si128(AlnumRun::member(x), inRange(x, 0x21, 0x7e));
+        }
+#endif
+
+        LILA_AVX2 static __m256i member(__m256i x) {
+          return _mm256_andnot_si256(AlnumRun::member(x), inRange(x, 0x21, 0x7e));
+        }
+#endif
+      };
+
+      struct BlankRun {
+        static bool member(unsigned char c) {
+          return charClasses.classes[c] == 0;
+        }
+
+#ifdef LILA_SCAN_X86
+#ifdef __SSE2__
+        static __m128i member(__m128i x) {
+          // neither visible nor newline
+          __m128i stop = _mm_or_si128(inRange(x, 0x21, 0x7e),
+                                      _mm_cmpeq_epi8(x, _mm_set1_epi8('\n')));
+          return _mm_cmpeq_epi8(stop, _mm_setzero_si128());
+        }
+#endif
+
+        LILA_AVX2 static __m256i member(__m256i x) {
+          __m256i stop = _mm256_or_si256(inRange(x, 0x21, 0x7e),
+                                         _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\n')));
+          return _mm256_cmpeq_epi8(stop, _mm256_setzero_si256());
+        }
+#endif
+      };
+
+      // -----------------------------------------------------------------------
+      // scanners
+      // -----------------------------------------------------------------------
+
+      template <typename Run>
+      const char * scanScalar(const char * p, const char * end) {
+        while (p < end && Run::member((unsigned char) *p))
+          p++;
+
+        return p;
+      }
+
+#ifdef LILA_SCAN_X86
+#ifdef __SSE2__
+      template <typename Run>
+      const char * scanSSE2(const char * p, const char * end) {
+        while (end - p >= 16) {
+          __m128i x = _mm_loadu_si128((const __m128i *) p);
+          unsigned stop = ~_mm_movemask_epi8(Run::member(x)) & 0xffff;
+
+          if (stop)
+            return p + __builtin_ctz(stop);
+
+          p += 16;
+        }
+
+        return scanScalar<Run>(p, end);
+      }
+#endif
+
+      template <typename Run>
+      LILA_AVX2 const char * scanAVX2(const char * p, const char * end) {
+        while (end - p >= 32) {
+          __m256i x = _mm256_loadu_si256((const __m256i *) p);
+          unsigned stop = ~(unsigned) _mm256_movemask_epi8(Run::member(x));
+
+          if (stop)
+            return p + __builtin_ctz(stop);
+
+          p += 32;
+        }
+
+        return scanScalar<Run>(p, end);
+      }
+#endif
+
+      typedef const char * (*Scanner)(const char *, const char *);
+
+      class Scanners {
+      public:
+        Scanner digits;
+        Scanner alnum;
+        Scanner punct;
+        Scanner blank;
+
+        template <template <typename> class Impl>
+        static Scanners get() {
+          return Scanners { Impl<DigitRun>::scan, Impl<AlnumRun>::scan,
+                            Impl<PunctRun>::scan, Impl<BlankRun>::scan };
+        }
+      };
+
+      template <typename Run> struct Scalar {
+        static const char * scan(const char * p, const char * end) {
+          return scanScalar<Run>(p, end);
+        }
+      };
+
+#ifdef LILA_SCAN_X86
+#ifdef __SSE2__
+      template <typename Run> struct SSE2 {
+        static const char * scan(const char * p, const char * end) {
+          return scanSSE2<Run>(p, end);
+        }
+      };
+#endif
+
+      template <typename Run> struct AVX2 {
+        static const char * scan(const char * p, const char * end) {
+          return scanAVX2<Run>(p, end);
+        }
+      };
+#endif
+
+      // LILA_SCAN=scalar or LILA_SCAN=sse2 forces a narrower implementation,
+      // so tests can compare the tokens of all of them on the same CPU
+      Scanners selectScanners() {
+        const char * forced = getenv("LILA_SCAN");
+
+        if (forced && strcmp(forced, "scalar") == 0)
+          return Scanners::get<Scalar>();
+
+#ifdef LILA_SCAN_X86
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports("avx2") && !(forced && strcmp(forced, "sse2") == 0))
+          return Scanners::get<AVX2>();
+
+#ifdef __SSE2__
+        return Scanners::get<SSE2>();
+#endif
+#endif
+        return Scanners::get<Scalar>();
+      }
+
+      const Scanners scanners = selectScanners();
+
+    }
+
+    const char * scanDigitsVector(const char * p, const char * end) {
+      return scanners.digits(p, end);
+    }
+
+    const char * scanAlnumVector(const char * p, const char * end) {
+      return scanners.alnum(p, end);
+    }
+
+    const char * scanPunctVector(const char * p, const char * end) {
+      return scanners.punct(p, end);
+    }
+
+    const char * scanBlankVector(const char * p, const char * end) {
+      return scanners.blank(p, end);
+    }
+
+  }
+}
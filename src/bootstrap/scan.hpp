@@ -0,0 +1,105 @@
+/*            __ __                                                     *\
+**     __    /_// /  ___            lila bootstrap compiler             **
+**    / /   __ / /  / _ |           (c) 2016, Christian Krause          **
+**   / /__ / // /__/ __ |                                               **
+**  /____//_//____/_/ | |                                               **
+\*                    |/                                                */
+
+#ifndef LILA_SCAN_H
+#define LILA_SCAN_H
+
+#include <cstdint>
+
+namespace lila {
+  namespace lexer {
+
+    // character classes of the lexer, equal to isdigit, isalpha, ispunct in
+    // the "C" locale
+    enum CharClass : uint8_t {
+      Digit = 1,
+      Alpha = 2,
+      Punct = 4,
+      Newline = 8
+    };
+
+    class CharClassTable {
+    public:
+      uint8_t classes[256];
+
+      constexpr CharClassTable() : classes() {
+        for (int c = 0; c < 256; c++) {
+          if (c >= '0' && c <= '9')
+            classes[c] = Digit;
+          else if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
+            classes[c] = Alpha;
+          else if (c >= 0x21 && c <= 0x7e)
+            classes[c] = Punct;
+          else if (c == '\n')
+            classes[c] = Newline;
+        }
+      }
+    };
+
+    constexpr CharClassTable charClasses;
+
+    inline bool isDigit(unsigned char c) {
+      return charClasses.classes[c] & Digit;
+    }
+
+    inline bool isAlpha(unsigned char c) {
+      return charClasses.classes[c] & Alpha;
+    }
+
+    inline bool isPunct(unsigned char c) {
+      return charClasses.classes[c] & Punct;
+    }
+
+    // The vectorized scanners return the first position in [p, end) that does
+    // not belong to their run, or end. They use AVX2 or SSE2 when the CPU
+    // supports it, and a scalar loop otherwise.
+
+    const char * scanDigitsVector(const char * p, const char * end);
+    const char * scanAlnumVector(const char * p, const char * end);
+    const char * scanPunctVector(const char * p, const char * end);
+    const char * scanBlankVector(const char * p, const char * end);
+
+    // Most runs are short, so the first byte is checked inline before handing
+    // over to the vectorized scanner.
+
+    // [0-9]*
+    inline const char * scanDigits(const char * p, const char * end) {
+      if (p < end && isDigit(*p))
+        return scanDigitsVector(p + 1, end);
+
+      return p;
+    }
+
+    // [a-zA-Z0-9]*
+    inline const char * scanAlnum(const char * p, const char * end) {
+      if (p < end && (isAlpha(*p) || isDigit(*p)))
+        return scanAlnumVector(p + 1, end);
+
+      return p;
+    }
+
+    // punctuation, including braces, parens and commas
+    inline const char * scanPunct(const char * p, const char * end) {
+      if (p < end && isPunct(*p))
+        return scanPunctVector(p + 1, end);
+
+      return p;
+    }
+
+    // bytes the lexer ignores, i.e. everything up to the next newline, brace
+    // or other visible character
+    inline const char * scanBlank(const char * p, const char * end) {
+      if (p < end && charClasses.classes[(unsigned char) *p] == 0)
+        return scanBlankVector(p + 1, end);
+
+      return p;
+    }
+
+  }
+}
+
+#endif
@@ -0,0 +1,478 @@
+/*            __ __                                                     *\
+**     __    /_// /  ___            lila bootstrap compiler             **
+**    / /   __ / /  / _ |           (c) 2016, Christian Krause          **
+**   / /__ / // /__/ __ |                                               **
+**  /____//_//____/_/ | |                                               **
+\*                    |/                                                */
+
+#include "server.hpp"
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <llvm/ADT/StringRef.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace lila {
+  namespace server {
+
+    // -------------------------------------------------------------------------
+    // limits
+    // -------------------------------------------------------------------------
+
+    // of a request or a response, beyond that the other side is broken
+    static const size_t maxMessageSize = 256 << 20;
+
+    // for the server to greet a client, before the client compiles on its
+    // own, and for a client to send its request and to take the response
+    static const chrono::seconds transferTimeout(10);
+
+    // of the greeting of a server
+    static const size_t maxVersionSize = 256;
+
+    // -------------------------------------------------------------------------
+    // messages
+    // -------------------------------------------------------------------------
+
+    // a message is a sequence of fields, each its length and its bytes, so
+    // sources and logs need no escaping
+
+    static void put(string &message, llvm::StringRef field) {
+      message += to_string(field.size());
+      message += ':';
+      message += field;
+    }
+
+    static void put(string &message, uint64_t number) {
+      put(message, to_string(number));
+    }
+
+    static bool get(llvm::StringRef &message, string &field) {
+      size_t colon = message.find(':');
+      uint64_t size;
+
+      if (colon == llvm::StringRef::npos ||
+          message.substr(0, colon).getAsInteger(10, size) ||
+          size > message.size() - colon - 1)
+        return false;
+
+      field = message.substr(colon + 1, size);
+      message = message.drop_front(colon + 1 + size);
+      return true;
+    }
+
+    template <typename T>
+    static bool get(llvm::StringRef &message, T &number) {
+      string field;
+      uint64_t value;
+
+      if (!get(message, field) || llvm::StringRef(field).getAsInteger(10, value))
+        return false;
+
+      number = T(value);
+      return true;
+    }
+
+    static string encode(const string &version, const Request &request) {
+      string message;
+
+      put(message, version);
+      put(message, request.input);
+      put(message, request.hasSource);
+      put(message, request.source);
+      put(message, request.output);
+      put(message, request.optLevel.speed);
+      put(message, request.optLevel.size);
+      put(message, unsigned(request.fileType));
+      put(message, request.splitJobs);
+      put(message, request.verbose);
+      put(message, request.streaming);
+      put(message, request.cacheDir);
+      put(message, request.incrementalDir);
+      put(message, request.cacheSize);
+
+      return message;
+    }
+
+    static bool decode(llvm::StringRef message, const string &version, Request &request) {
+      string clientVersion;
+      unsigned fileType;
+
+      if (!get(message, clientVersion) || clientVersion != version)
+        return false;
+
+      bool decoded =
+        get(message, request.input) &&
+        get(message, request.hasSource) &&
+        get(message, request.source) &&
+        get(message, request.output) &&
+        get(message, request.optLevel.speed) &&
+        get(message, request.optLevel.size) &&
+        get(message, fileType) &&
+        get(message, request.splitJobs) &&
+        get(message, request.verbose) &&
+        get(message, request.streaming) &&
+        get(message, request.cacheDir) &&
+        get(message, request.incrementalDir) &&
+        get(message, request.cacheSize);
+
+      if (!decoded || fileType > unsigned(backend::FileType::Bitcode))
+        return false;
+
+      request.fileType = backend::FileType(fileType);
+      return message.empty();
+    }
+
+    static string encode(const Response &response) {
+      string message;
+
+      put(message, uint64_t(response.status));
+      put(message, response.log);
+
+      return message;
+    }
+
+    static bool decode(llvm::StringRef message, Response &response) {
+      return get(message, response.status) && get(message, response.log) && message.empty();
+    }
+
+    // -------------------------------------------------------------------------
+    // sockets
+    // -------------------------------------------------------------------------
+
+    typedef chrono::steady_clock::time_point Deadline;
+
+    static Deadline after(chrono::seconds timeout) {
+      return chrono::steady_clock::now() + timeout;
+    }
+
+    static const Deadline never = Deadline::max();
+
+    // waits until fd is ready for events, false on timeout or error
+    static bool await(int fd, short events, Deadline deadline) {
+      while (true) {
+        auto left = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now());
+
+        if (left.count() <= 0)
+          return false;
+
+        // a minute at most, so the timeout of poll does not overflow
+        pollfd poller = { fd, events, 0 };
+        int ready = poll(&poller, 1, int(std::min<int64_t>(left.count(), 60000)));
+
+        if ((ready < 0 && errno == EINTR) || ready == 0)
+          continue;
+
+        return ready > 0;
+      }
+    }
+
+    static bool sendAll(int fd, llvm::StringRef data, Deadline deadline) {
+      while (!data.empty()) {
+        if (!await(fd, POLLOUT, deadline))
+          return false;
+
+        ssize_t sent = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+
+        if (sent < 0 && errno == EINTR)
+          continue;
+
+        if (sent < 0)
+          return false;
+
+        data = data.drop_front(sent);
+      }
+
+      return true;
+    }
+
+    // until the other side shuts down its end
+    static bool receiveAll(int fd, string &data, Deadline deadline) {
+      char buffer[65536];
+
+      while (true) {
+        if (!await(fd, POLLIN, deadline))
+          return false;
+
+        ssize_t received = read(fd, buffer, sizeof(buffer));
+
+        if (received < 0 && errno == EINTR)
+          continue;
+
+        if (received < 0)
+          return false;
+
+        if (received == 0)
+          return true;
+
+        if (data.size() + received > maxMessageSize)
+          return false;
+
+        data.append(buffer, received);
+      }
+    }
+
+    // a single field of at most maxSize bytes, without waiting for the other
+    // side to shut down its end
+    static bool receiveField(int fd, string &field, size_t maxSize, Deadline deadline) {
+      string size;
+      char c = 0;
+
+      while (c != ':') {
+        if (!await(fd, POLLIN, deadline))
+          return false;
+
+        ssize_t received = read(fd, &c, 1);
+
+        if (received < 0 && errno == EINTR)
+          continue;
+
+        if (received <= 0 || size.size() > 20)
+          return false;
+
+        if (c != ':')
+          size += c;
+      }
+
+      uint64_t length;
+
+      if (llvm::StringRef(size).getAsInteger(10, length) || length > maxSize)
+        return false;
+
+      field.resize(length);
+
+      for (size_t done = 0; done < length; ) {
+        if (!await(fd, POLLIN, deadline))
+          return false;
+
+        ssize_t received = read(fd, &field[done], length - done);
+
+        if (received < 0 && errno == EINTR)
+          continue;
+
+        if (received <= 0)
+          return false;
+
+        done += received;
+      }
+
+      return true;
+    }
+
+    static bool address(const string &path, sockaddr_un &addr, string &error) {
+      if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        error = "invalid socket path: " + path;
+        return false;
+      }
+
+      memset(&addr, 0, sizeof(addr));
+      addr.sun_family = AF_UNIX;
+      memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+      return true;
+    }
+
+    // -1 and errno set if nobody listens at addr
+    static int connectTo(const sockaddr_un &addr) {
+      int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+      if (fd < 0)
+        return -1;
+
+      if (connect(fd, (const sockaddr *) &addr, sizeof(addr)) < 0) {
+        int connectError = errno;
+        close(fd);
+        errno = connectError;
+        return -1;
+      }
+
+      return fd;
+    }
+
+    // -------------------------------------------------------------------------
+    // server
+    // -------------------------------------------------------------------------
+
+    static char socketPath[sizeof(sockaddr_un::sun_path)];
+
+    static void removeSocket(int) {
+      unlink(socketPath);
+      _exit(0);
+    }
+
+    static void handleConnection(int client, unsigned worker, const string &version,
+                                 Handler &handle) {
+      string greeting;
+      put(greeting, version);
+
+      // a client that gave up waiting for the greeting has not sent its
+      // request, so nothing is compiled for it
+      if (!sendAll(client, greeting, after(transferTimeout)))
+        return;
+
+      string message;
+      Request request;
+
+      if (!receiveAll(client, message, after(transferTimeout)) ||
+          !decode(message, version, request))
+        return;
+
+      Response response;
+      handle(worker, request, response);
+
+      sendAll(client, encode(response), after(transferTimeout));
+    }
+
+    bool serve(const string &path, const string &version, unsigned workers,
+               Handler handle, string &error) {
+      sockaddr_un addr;
+
+      if (!address(path, addr, error))
+        return false;
+
+      int running = connectTo(addr);
+
+      if (running >= 0) {
+        close(running);
+        error = "a server already listens on " + path;
+        return false;
+      }
+
+      // left over by a server that was killed, but never any other file
+      struct stat status;
+      if (stat(path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode))
+        unlink(path.c_str());
+
+      int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+      if (fd < 0) {
+        error = string("cannot create socket: ") + strerror(errno);
+        return false;
+      }
+
+      // the server writes files with the permissions of its user, so only
+      // that user may connect
+      mode_t mask = umask(0077);
+      int bound = bind(fd, (const sockaddr *) &addr, sizeof(addr));
+      umask(mask);
+
+      if (bound < 0 || listen(fd, SOMAXCONN) < 0) {
+        error = "cannot listen on " + path + ": " + strerror(errno);
+        close(fd);
+        return false;
+      }
+
+      strcpy(socketPath, path.c_str());
+      signal(SIGINT, removeSocket);
+      signal(SIGTERM, removeSocket);
+
+      // a client that goes away must not end the server
+      signal(SIGPIPE, SIG_IGN);
+
+      // workers take the next connection as soon as they are done with one
+      auto work = [&](unsigned worker) {
+        while (true) {
+          int client = accept(fd, nullptr, nullptr);
+
+          if (client < 0 && (errno == EINTR || errno == ECONNABORTED))
+            continue;
+
+          // e.g. out of file descriptors, which takes other connections to
+          // be closed first
+          if (client < 0) {
+            cerr << "[server] [error] accept failed: " << strerror(errno) << endl;
+            std::this_thread::sleep_for(chrono::seconds(1));
+            continue;
+          }
+
+          handleConnection(client, worker, version, handle);
+          close(client);
+        }
+      };
+
+      vector<std::thread> threads;
+
+      for (unsigned i = 1; i < workers; i++)
+        threads.emplace_back(work, i);
+
+      // workers serve until the process ends
+      work(0);
+
+      return true;
+    }
+
+    // -------------------------------------------------------------------------
+    // client
+    // -------------------------------------------------------------------------
+
+    bool forward(const string &path, const string &version, const Request &request,
+                 Response &response, string &error) {
+      sockaddr_un addr;
+
+      if (!address(path, addr, error))
+        return false;
+
+      int fd = connectTo(addr);
+
+      if (fd < 0) {
+        error = "cannot connect to " + path + ": " + strerror(errno);
+        return false;
+      }
+
+      // a server with all workers busy or stuck still accepts connections,
+      // but greets a client only when a worker takes its request
+      string serverVersion;
+
+      if (!receiveField(fd, serverVersion, maxVersionSize, after(transferTimeout))) {
+        close(fd);
+        error = "no greeting from the server at " + path;
+        return false;
+      }
+
+      if (serverVersion != version) {
+        close(fd);
+        error = "the server at " + path + " is " + serverVersion;
+        return false;
+      }
+
+      // a request that is sent as a whole may be compiled, so from here on the
+      // client must not write the output itself, the server may still do so
+      string message;
+
+      if (!sendAll(fd, encode(version, request), after(transferTimeout))) {
+        close(fd);
+        error = "cannot send the request to the server at " + path;
+        return false;
+      }
+
+      bool answered =
+        shutdown(fd, SHUT_WR) == 0 &&
+        receiveAll(fd, message, never) &&
+        decode(message, response);
+
+      close(fd);
+
+      if (!answered) {
+        response.status = 1;
+        response.log = "error: no answer from the server at " + path + "\n";
+      }
+
+      return true;
+    }
+
+  }
+}
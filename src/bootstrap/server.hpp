@@ -0,0 +1,74 @@
+/*            __ __                                                     *\
+**     __    /_// /  ___            lila bootstrap compiler             **
+**    / /   __ / /  / _ |           (c) 2016, Christian Krause          **
+**   / /__ / // /__/ __ |                                               **
+**  /____//_//____/_/ | |                                               **
+\*                    |/                                                */
+
+#ifndef LILA_SERVER_H
+#define LILA_SERVER_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "backend.hpp"
+
+using namespace std;
+
+namespace lila {
+  namespace server {
+
+    // A compilation a client hands to the server. Paths are absolute, the
+    // server does not share the working directory of the client.
+    class Request {
+    public:
+      string input;
+      bool hasSource = false; // the client read the source, e.g. from STDIN
+      string source;
+      string output;
+
+      backend::OptLevel optLevel;
+      backend::FileType fileType = backend::FileType::Object;
+      unsigned splitJobs = 0;
+      bool verbose = false;
+      bool streaming = false;
+
+      string cacheDir;       // empty for none
+      string incrementalDir; // empty for none
+      uint64_t cacheSize = 256; // MiB
+    };
+
+    // exit status and diagnostics of a compilation
+    class Response {
+    public:
+      int status = 1;
+      string log;
+    };
+
+    // handles a request on the worker thread with the given index
+    typedef function<void(unsigned worker, const Request &request, Response &response)> Handler;
+
+    // Listens on the Unix domain socket at path, only for the user of the
+    // server, and handles the request of each connection on one of workers
+    // threads. A worker greets the client with the version of the server
+    // before it takes the request, requests of clients of another version
+    // are not answered. Returns only if it can not listen, with error set,
+    // and removes the socket when the server is interrupted or terminated.
+    bool serve(const string &path, const string &version, unsigned workers,
+               Handler handle, string &error);
+
+    // Sends request to the server listening at path and waits for its
+    // response. False and error set if the request was not handed over,
+    // because there is no server of the same version or it does not greet
+    // the client within ten seconds, and then nothing is compiled for it.
+    // Once handed over, the request may be compiled, so this waits for the
+    // response as long as the server lives, and a server that goes away
+    // without one gives a failed response.
+    bool forward(const string &path, const string &version, const Request &request,
+                 Response &response, string &error);
+
+  }
+}
+
+#endif
@@ -0,0 +1,375 @@
+/*            __ __                                                     *\
+**     __    /_// /  ___            lila bootstrap compiler             **
+**    / /   __ / /  / _ |           (c) 2016, Christian Krause          **
+**   / /__ / // /__/ __ |                                               **
+**  /____//_//____/_/ | |                                               **
+\*                    |/                                                */
+
+#include "session.hpp"
+
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/raw_os_ostream.h>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "cache.hpp"
+#include "codegen.hpp"
+#include "folder.hpp"
+#include "jit.hpp"
+#include "parser.hpp"
+#include "resolver.hpp"
+#include "specializer.hpp"
+
+using namespace lila::backend;
+using namespace lila::cache;
+using namespace lila::codegen;
+using namespace lila::folder;
+using namespace lila::jit;
+using namespace lila::parser;
+using namespace lila::resolver;
+using namespace lila::specializer;
+using namespace lila::trace;
+
+namespace lila {
+  namespace session {
+
+    // only object files are written in parts, programs run are optimized as
+    // a whole
+    static bool splitsObject(const Options &options) {
+      return options.splitJobs && options.fileType == FileType::Object && !options.run;
+    }
+
+    vector<string> objectConfig(const Options &options) {
+      return {
+        PACKAGE_STRING,
+        hostTriple(),
+        hostCPU(),
+        hostFeatures(),
+        "O" + to_string(options.optLevel.speed) + "s" + to_string(options.optLevel.size),
+        fileExtension(options.fileType),
+        !splitsObject(options) ? "whole" : !options.incrementalDir.empty() ? "incremental" : "split"
+      };
+    }
+
+    static void dump(llvm::Module &module, ostream &log) {
+      llvm::raw_os_ostream stream(log);
+      module.print(stream, nullptr);
+    }
+
+    static uint64_t countInstructions(const llvm::Module &module) {
+      uint64_t count = 0;
+
+      for (auto &function : module)
+        for (auto &block : function)
+          count += block.size();
+
+      return count;
+    }
+
+    Session::Session(const Options &options)
+      : options(options) {
+      if (!splitsObject(options))
+        this->options.splitJobs = 0;
+    }
+
+    void Session::setOptions(const Options &options) {
+      if (options.optLevel.speed != this->options.optLevel.speed ||
+          options.optLevel.size != this->options.optLevel.size ||
+          options.run != this->options.run)
+        target.reset();
+
+      this->options = options;
+
+      if (!splitsObject(options))
+        this->options.splitJobs = 0;
+    }
+
+    string Session::takeDiagnostics() {
+      string text = diagnostics.str();
+      diagnostics.str("");
+      return text;
+    }
+
+    int Session::compile(unique_ptr<llvm::MemoryBuffer> buffer, const char *input,
+                         const char *output) {
+      ostream &log = diagnostics;
+
+      // -----------------------------------------------------------------------
+      // look up the object in the cache
+      // -----------------------------------------------------------------------
+
+      unique_ptr<ObjectCache> cache;
+      string cacheKey;
+
+      if (!options.cacheDir.empty() && !options.run) {
+        Trace::Scope lookingUp(options.trace, "cache lookup", input);
+        cache = llvm::make_unique<ObjectCache>(options.cacheDir, options.cacheSize << 20);
+
+        cacheKey = ObjectCache::key(buffer->getBuffer(), objectConfig(options));
+
+        if (cache->fetch(cacheKey, output)) {
+          if (options.verbose)
+            log << "[cache] hit " << cacheKey << endl;
+          return 0;
+        }
+
+        if (options.verbose)
+          log << "[cache] miss " << cacheKey << endl;
+      }
+
+      // names are interned once and shared by all phases of this compilation
+      SymbolTable symbols;
+      OperatorTable operators(symbols);
+      unique_ptr<LexerResult> lexerResult;
+      unique_ptr<Lexer> lexer;
+      unique_ptr<Parser> parser;
+
+      if (options.streaming) {
+        lexer = llvm::make_unique<Lexer>(buffer->getBuffer(), symbols);
+        parser = llvm::make_unique<Parser>(lexer.get(), symbols, operators);
+
+        if (options.verbose)
+          parser->echoTokens(&log);
+
+      } else {
+        Trace::Scope tokenizing(options.trace, "tokenize", input);
+        lexerResult = tokenize(move(buffer), symbols);
+        tokenizing.end();
+
+        if (auto failure = llvm::dyn_cast<LexerFailure>(lexerResult.get())) {
+          log << "[lexer] [error] " << failure->msg << endl;
+          return 1;
+        }
+
+        LexerSuccess * lexsuccess = llvm::cast<LexerSuccess>(lexerResult.get());
+        TokenStream * tokens = lexsuccess->tokens.get();
+
+        if (options.trace)
+          options.trace->count("tokens", tokens->size());
+
+        if (options.verbose)
+          for (size_t i = 0; i < tokens->size(); i++)
+            log << "[token] \"" << tokens->toString(i) << "\"" << endl;
+
+        parser = llvm::make_unique<Parser>(tokens, symbols, operators);
+      }
+
+      // -----------------------------------------------------------------------
+      // parse the tokens to AST
+      // -----------------------------------------------------------------------
+
+      // tokenizes too when streaming
+      Trace::Scope parsing(options.trace, "parse", input);
+      auto parserResult = parser->parse();
+      parsing.end();
+
+      if (lexer && lexer->failed()) {
+        log << "[lexer] [error] " << lexer->error << endl;
+        return 1;
+      }
+
+      if (auto failure = llvm::dyn_cast<ParserFailure>(parserResult.get())) {
+        log << "[parser] [error] " << failure->msg << endl;
+        return 1;
+      }
+
+      auto parsesuccess = llvm::cast<ParserSuccess>(parserResult.get());
+      auto ast = move(parsesuccess->ast);
+
+      if (options.trace)
+        options.trace->count("AST nodes", ast->size());
+
+      if (options.verbose)
+        log << "[ast]" << endl << ast->toString(ast->root, symbols) << "[/ast]" << endl;
+
+      // -----------------------------------------------------------------------
+      // bind names to their declarations
+      // -----------------------------------------------------------------------
+
+      Resolver resolver(symbols);
+
+      Trace::Scope resolving(options.trace, "resolve", input);
+      auto resolverResult = resolver.resolve(move(ast));
+      resolving.end();
+
+      if (options.trace)
+        options.trace->count("scope lookups", resolver.lookups);
+
+      if (auto failure = llvm::dyn_cast<ResolverFailure>(resolverResult.get())) {
+        log << "[resolver] [error] " << failure->msg << endl;
+        return 1;
+      }
+
+      auto resolvesuccess = llvm::cast<ResolverSuccess>(resolverResult.get());
+      ast = move(resolvesuccess->ast);
+
+      // -----------------------------------------------------------------------
+      // evaluate constant expressions
+      // -----------------------------------------------------------------------
+
+      Trace::Scope folding(options.trace, "fold", input);
+
+      Folder folder;
+      folder.fold(*ast);
+
+      // clones of defs for constant arguments, not at -O0 and not when
+      // optimizing for size
+      if (options.optLevel.speed > 0 && options.optLevel.size == 0) {
+        Specializer specializer(symbols);
+        specializer.specialize(*ast);
+        folder.fold(*ast);
+      }
+
+      folding.end();
+
+      if (options.verbose)
+        log << "[folded]" << endl << ast->toString(ast->root, symbols) << "[/folded]" << endl;
+
+      // -----------------------------------------------------------------------
+      // generate LLVM IR code
+      // -----------------------------------------------------------------------
+
+      context = llvm::make_unique<llvm::LLVMContext>();
+      CodeGen codegen("lilamodule", *context, symbols);
+
+      Trace::Scope generating(options.trace, "codegen", input);
+      auto cgresult = codegen.generateCode(move(ast));
+      generating.end();
+
+      if (auto failure = llvm::dyn_cast<CodegenFailure>(cgresult.get())) {
+        log << "[codegen] [error] " << failure->msg << endl;
+        return 1;
+      }
+
+      auto cgsuccess = llvm::cast<CodegenSuccess>(cgresult.get());
+      auto module = move(cgsuccess->module);
+
+      if (options.trace)
+        options.trace->count("IR instructions", countInstructions(*module));
+
+      if (options.verbose)
+        dump(*module, log);
+
+      // codegen verifies each function, this is the module as a whole
+      Trace::Scope verifying(options.trace, "verify", input);
+      string verifyS;
+      llvm::raw_string_ostream verifyE(verifyS);
+
+      if (llvm::verifyModule(*module, &verifyE)) {
+        log << "[codegen] [error] invalid module: " << verifyE.str() << endl;
+        return 1;
+      }
+
+      verifying.end();
+
+      // -----------------------------------------------------------------------
+      // optimize for the host
+      // -----------------------------------------------------------------------
+
+      string error;
+
+      if (!target) {
+        Trace::Scope creating(options.trace, "create target machine", input);
+        target = createTargetMachine(options.optLevel, error, options.run);
+      }
+
+      if (!target) {
+        log << error << endl;
+        return 1;
+      }
+
+      prepareModule(*module, *target, options.optLevel);
+
+      // split programs are optimized part by part when writing the object file
+      if (!options.splitJobs) {
+        Trace::Scope optimizing(options.trace, "optimize", input);
+        optimizeModule(*module, *target, options.optLevel, options.trace);
+        optimizing.end();
+
+        if (options.trace)
+          options.trace->count("optimized IR instructions", countInstructions(*module));
+
+        if (options.verbose) {
+          log << "[optimized]" << endl;
+          dump(*module, log);
+        }
+      }
+
+      // -----------------------------------------------------------------------
+      // run in memory
+      // -----------------------------------------------------------------------
+
+      if (options.run) {
+        Trace::Scope jitting(options.trace, "jit", input);
+
+        JIT jit(move(target));
+        jit.addModule(move(module));
+
+        auto mainFunc = (void (*)()) jit.getSymbolAddress("main");
+        jitting.end();
+
+        if (!mainFunc) {
+          log << "[jit] [error] main not found" << endl;
+          return 1;
+        }
+
+        mainFunc();
+        return 0;
+      }
+
+      // -----------------------------------------------------------------------
+      // write object file, assembly, IR or bitcode
+      // -----------------------------------------------------------------------
+
+      // objects of the parts of the program compiled before
+      unique_ptr<ObjectCache> parts;
+
+      if (options.splitJobs && !options.incrementalDir.empty())
+        parts = llvm::make_unique<ObjectCache>(options.incrementalDir, options.cacheSize << 20);
+
+      Trace::Scope emitting(options.trace,
+                            options.splitJobs ? "optimize and emit parts" : "emit", input);
+
+      bool emitted = options.splitJobs
+        ? emitObjectParallel(move(module), *target, options.optLevel, options.splitJobs, output,
+                             error, parts.get(), objectConfig(options), options.trace)
+        : emitFile(*module, *target, options.fileType, output, error);
+
+      if (!emitted) {
+        log << "error: " << error << endl;
+        return 1;
+      }
+
+      emitting.end();
+
+      uint64_t size;
+      if (options.trace && !llvm::sys::fs::file_size(output, size))
+        options.trace->count("emitted bytes", size);
+
+      // only regular files, not e.g. /dev/null or STDOUT
+      if (cache && llvm::sys::fs::is_regular_file(output))
+        cache->store(cacheKey, output);
+
+      return 0;
+    }
+
+    int Session::compile(const char *input, const char *output) {
+      // files are memory-mapped, STDIN ("-") is read into a single buffer
+      Trace::Scope reading(options.trace, "read", input);
+      auto source = llvm::MemoryBuffer::getFileOrSTDIN(input);
+      reading.end();
+
+      if (!source) {
+        diagnostics << "error opening file: " << input << endl;
+        return 1;
+      }
+
+      return compile(move(*source), input, output);
+    }
+
+  }
+}
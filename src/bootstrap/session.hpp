@@ -0,0 +1,90 @@
+/*            __ __                                                     *\
+**     __    /_// /  ___            lila bootstrap compiler             **
+**    / /   __ / /  / _ |           (c) 2016, Christian Krause          **
+**   / /__ / // /__/ __ |                                               **
+**  /____//_//____/_/ | |                                               **
+\*                    |/                                                */
+
+#ifndef LILA_SESSION_H
+#define LILA_SESSION_H
+
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Target/TargetMachine.h>
+
+#include "backend.hpp"
+#include "trace.hpp"
+
+namespace lila {
+  namespace session {
+
+    // what a session does with each program
+    class Options {
+    public:
+      bool verbose = false;
+      bool streaming = false;
+      bool run = false;
+      unsigned splitJobs = 0; // threads for the parts of an object, 0 to not split,
+                              // ignored for other file types and programs run
+      backend::OptLevel optLevel;
+      backend::FileType fileType = backend::FileType::Object;
+
+      std::string cacheDir;       // empty for none
+      std::string incrementalDir; // empty for none
+      uint64_t cacheSize = 256; // MiB
+
+      trace::Trace *trace = nullptr;
+    };
+
+    // everything besides the source that an object depends on
+    std::vector<std::string> objectConfig(const Options &options);
+
+    // Compiles programs from source to object files, or runs them, one after
+    // the other. A session has its own options, LLVM context, target machine
+    // and diagnostics, so sessions on different threads share nothing but
+    // the cache directories they are given.
+    class Session {
+    private:
+      Options options;
+
+      // created for the first program and kept for the next ones
+      std::unique_ptr<llvm::TargetMachine> target;
+
+      // of the last program, each program gets a new one so that a long
+      // session does not keep the types and constants of all of them
+      std::unique_ptr<llvm::LLVMContext> context;
+
+      std::ostringstream diagnostics;
+
+    public:
+      explicit Session(const Options &options = Options());
+
+      const Options &getOptions() const {
+        return options;
+      }
+
+      // options for the next programs, the target machine is kept unless
+      // the optimization level changes or programs run instead
+      void setOptions(const Options &options);
+
+      // compiles the source in buffer, called input in diagnostics, to
+      // output, or runs it, and returns the exit status
+      int compile(std::unique_ptr<llvm::MemoryBuffer> buffer, const char *input, const char *output);
+
+      // reads input, "-" for STDIN, and compiles it
+      int compile(const char *input, const char *output);
+
+      // errors and verbose output of the programs since the last call
+      std::string takeDiagnostics();
+    };
+
+  }
+}
+
+#endif
@@ -0,0 +1,349 @@
+/*            __ __                                                     *\
+**     __    /_// /  ___            lila bootstrap compiler             **
+**    / /   __ / /  / _ |           (c) 2016, Christian Krause          **
+**   / /__ / // /__/ __ |                                               **
+**  /____//_//____/_/ | |                                               **
+\*                    |/                                                */
+
+#include "specializer.hpp"
+
+#include <cstring>
+#include <iterator>
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/MD5.h>
+
+namespace lila {
+  namespace specializer {
+
+    // A clone is named after its def and a hash of its constants, not after
+    // how many clones came before it, so code elsewhere in the program does
+    // not rename it.
+    static string cloneSuffix(const vector<pair<uint32_t, uint64_t> > &constants) {
+      llvm::MD5 hash;
+
+      for (auto &constant : constants)
+        hash.update(to_string(constant.first) + ":" + to_string(constant.second) + ",");
+
+      llvm::MD5::MD5Result result;
+      hash.final(result);
+
+      llvm::SmallString<32> hex;
+      llvm::MD5::stringifyResult(result, hex);
+      return hex.str().substr(0, 8).str();
+    }
+
+    // Cloning adds nodes to the AST, so no reference to a node or into a node
+    // list is kept across calls that may clone.
+
+    Node Specializer::specializeExpr(Node node) {
+      switch (node.kind()) {
+      case ASTKind::BinaryExpr:
+        return specializeBinary(node);
+      case ASTKind::Call:
+        return specializeCall(node);
+      case ASTKind::Block:
+        specializeBlock(node);
+        return node;
+      default:
+        return node;
+      }
+    }
+
+    void Specializer::specializeBlock(Node node) {
+      Range body = ast->block(node).body;
+
+      frames.push_back(Frame());
+      frames.back().block = node;
+      frames.back().defs.resize(ast->block(node).frameSize);
+
+      for (uint32_t i = 0; i < body.size; i++) {
+        Node item = ast->nodeLists[body.begin + i];
+
+        switch (item.kind()) {
+        case ASTKind::Value: {
+          Node expr = specializeExpr(ast->value(item).expr);
+          ast->value(item).expr = expr;
+          break;
+        }
+        case ASTKind::Def:
+          specializeDef(item);
+          frames.back().defs[ast->def(item).slot] = item;
+          break;
+        default: {
+          Node expr = specializeExpr(item);
+          ast->nodeLists[body.begin + i] = expr;
+          break;
+        }
+        }
+      }
+
+      Frame frame = move(frames.back());
+      frames.pop_back();
+
+      if (frame.clones.empty())
+        return;
+
+      // clones see what their def sees, so they follow it
+      vector<Node> items;
+      for (uint32_t i = 0; i < body.size; i++) {
+        Node item = ast->nodeLists[body.begin + i];
+        items.push_back(item);
+
+        if (item.kind() != ASTKind::Def)
+          continue;
+
+        // clones of clones follow their def as well
+        for (size_t j = items.size() - 1; j < items.size(); j++)
+          for (auto &clone : frame.clones)
+            if (clone.first.index() == items[j].index())
+              items.push_back(clone.second);
+      }
+
+      Range newBody = ast->addNodes(items);
+      ast->block(node).body = newBody;
+    }
+
+    Node Specializer::specializeBinary(Node node) {
+      Node lhs = specializeExpr(ast->binary(node).lhs);
+      ast->binary(node).lhs = lhs;
+
+      Node rhs = specializeExpr(ast->binary(node).rhs);
+      ast->binary(node).rhs = rhs;
+
+      if (ast->binary(node).builtin != BuiltinOp::None)
+        return node;
+
+      // a user operator with one constant operand becomes a call of the clone
+      Specialization specialization;
+      vector<Node> remaining;
+      if (!specialize(ast->binary(node).binding, { lhs, rhs }, specialization, remaining))
+        return node;
+
+      Node call = ast->addCall(specialization.name, ast->addNodes(remaining));
+      ast->call(call).binding = specialization.binding;
+      return call;
+    }
+
+    Node Specializer::specializeCall(Node node) {
+      Range args = ast->call(node).args;
+
+      for (uint32_t i = 0; i < args.size; i++) {
+        Node arg = specializeExpr(ast->nodeLists[args.begin + i]);
+        ast->nodeLists[args.begin + i] = arg;
+      }
+
+      if (!ast->call(node).binding.def)
+        return node;
+
+      auto argList = ast->nodeList(args);
+      vector<Node> argNodes(argList.begin(), argList.end());
+
+      Specialization specialization;
+      vector<Node> remaining;
+      if (!specialize(ast->call(node).binding, argNodes, specialization, remaining))
+        return node;
+
+      Node call = ast->addCall(specialization.name, ast->addNodes(remaining));
+      ast->call(call).binding = specialization.binding;
+      return call;
+    }
+
+    void Specializer::specializeDef(Node node) {
+      // the frame of the arguments declares no defs
+      frames.push_back(Frame());
+
+      Node body = specializeExpr(ast->def(node).body);
+      ast->def(node).body = body;
+
+      frames.pop_back();
+    }
+
+    bool Specializer::specialize(Binding binding, const vector<Node> &args,
+                                 Specialization &result, vector<Node> &remaining) {
+      Node def = frames[binding.depth].defs[binding.slot];
+      if (!def)
+        return false;
+
+      // code generation reports calls with the wrong number of arguments
+      Range argNames = ast->def(def).args;
+      if (argNames.size != args.size())
+        return false;
+
+      Signature signature;
+      signature.first = def.index();
+
+      Substitution substitution;
+      substitution.depth = binding.depth + 1;
+      substitution.constants.resize(args.size());
+      substitution.slots.resize(args.size());
+
+      vector<Symbol> names;
+
+      for (uint32_t i = 0; i < args.size(); i++) {
+        if (args[i].kind() == ASTKind::Number) {
+          // by bits, as 0 and -0 differ and NaN differs from itself
+          uint64_t bits;
+          double value = ast->number(args[i]).value;
+          memcpy(&bits, &value, sizeof(bits));
+
+          signature.second.push_back(make_pair(i, bits));
+          substitution.constants[i] = args[i];
+        } else {
+          substitution.slots[i] = remaining.size();
+          remaining.push_back(args[i]);
+          names.push_back(ast->symbolLists[argNames.begin + i]);
+        }
+      }
+
+      // nothing to substitute, or nothing left that the folder would not
+      // have evaluated already
+      if (signature.second.empty() || remaining.empty())
+        return false;
+
+      auto cached = cache.find(signature);
+      if (cached != cache.end()) {
+        result = cached->second;
+        return true;
+      }
+
+      uint32_t defSize = size(ast->def(def).body);
+      if (defSize > maxDefSize || defSize > budget)
+        return false;
+
+      budget -= defSize;
+
+      Node body = clone(ast->def(def).body, substitution);
+      Symbol name = symbols.intern(symbols.str(ast->def(def).name) + "." + cloneSuffix(signature.second));
+      Node specialized = ast->addDef(name, ast->addSymbols(names), body);
+
+      Frame &owner = frames[binding.depth];
+      uint32_t slot = ast->block(owner.block).frameSize++;
+      owner.defs.push_back(specialized);
+      owner.clones.push_back(make_pair(def, specialized));
+      ast->def(specialized).slot = slot;
+
+      result.name = name;
+      result.binding = binding;
+      result.binding.slot = slot;
+      cache[signature] = result;
+
+      // calls within the clone may have constant arguments now, specialize
+      // them in the frames the def sees
+      auto begin = frames.begin() + binding.depth + 1;
+      vector<Frame> caller(make_move_iterator(begin), make_move_iterator(frames.end()));
+      frames.erase(begin, frames.end());
+
+      specializeDef(specialized);
+
+      frames.insert(frames.end(), make_move_iterator(caller.begin()), make_move_iterator(caller.end()));
+
+      return true;
+    }
+
+    Node Specializer::clone(Node node, const Substitution &substitution) {
+      switch (node.kind()) {
+      case ASTKind::Number:
+        // never changed, so shared
+        return node;
+
+      case ASTKind::BinaryExpr: {
+        BinaryNode binary = ast->binary(node);
+        Node lhs = clone(binary.lhs, substitution);
+        Node rhs = clone(binary.rhs, substitution);
+        Node copy = ast->addBinary(binary.op, binary.builtin, lhs, rhs);
+        ast->binary(copy).binding = binary.binding;
+        return copy;
+      }
+
+      case ASTKind::Call: {
+        CallNode call = ast->call(node);
+        bool argument = !call.binding.def && call.binding.depth == substitution.depth;
+
+        if (argument && substitution.constants[call.binding.slot])
+          return substitution.constants[call.binding.slot];
+
+        vector<Node> args;
+        for (uint32_t i = 0; i < call.args.size; i++)
+          args.push_back(clone(ast->nodeLists[call.args.begin + i], substitution));
+
+        Node copy = ast->addCall(call.name, ast->addNodes(args));
+        ast->call(copy).binding = call.binding;
+
+        if (argument)
+          ast->call(copy).binding.slot = substitution.slots[call.binding.slot];
+
+        return copy;
+      }
+
+      case ASTKind::Block: {
+        BlockNode block = ast->block(node);
+
+        vector<Node> items;
+        for (uint32_t i = 0; i < block.body.size; i++)
+          items.push_back(clone(ast->nodeLists[block.body.begin + i], substitution));
+
+        Node copy = ast->addBlock(ast->addNodes(items), block.indent);
+        ast->block(copy).frameSize = block.frameSize;
+        return copy;
+      }
+
+      case ASTKind::Value: {
+        ValueNode value = ast->value(node);
+        Node expr = clone(value.expr, substitution);
+        Node copy = ast->addValue(value.name, expr);
+        ast->value(copy).slot = value.slot;
+        return copy;
+      }
+
+      case ASTKind::Def: {
+        DefNode def = ast->def(node);
+        Node body = clone(def.body, substitution);
+        Node copy = ast->addDef(def.name, def.args, body);
+        ast->def(copy).slot = def.slot;
+        return copy;
+      }
+      }
+
+      return node;
+    }
+
+    uint32_t Specializer::size(Node node) const {
+      uint32_t result = 1;
+
+      switch (node.kind()) {
+      case ASTKind::Number:
+        break;
+      case ASTKind::BinaryExpr:
+        result += size(ast->binaries[node.index()].lhs) + size(ast->binaries[node.index()].rhs);
+        break;
+      case ASTKind::Call:
+        for (auto arg : ast->nodeList(ast->calls[node.index()].args))
+          result += size(arg);
+        break;
+      case ASTKind::Block:
+        for (auto item : ast->nodeList(ast->blocks[node.index()].body))
+          result += size(item);
+        break;
+      case ASTKind::Value:
+        result += size(ast->values[node.index()].expr);
+        break;
+      case ASTKind::Def:
+        result += size(ast->defs[node.index()].body);
+        break;
+      }
+
+      return result;
+    }
+
+    void Specializer::specialize(AST &ast) {
+      this->ast = &ast;
+      frames.clear();
+      cache.clear();
+
+      if (ast.root && ast.root.kind() == ASTKind::Block)
+        specializeBlock(ast.root);
+    }
+
+  }
+}
@@ -0,0 +1,90 @@
+/*            __ __                                                     *\
+**     __    /_// /  ___            lila bootstrap compiler             **
+**    / /   __ / /  / _ |           (c) 2016, Christian Krause          **
+**   / /__ / // /__/ __ |                                               **
+**  /____//_//____/_/ | |                                               **
+\*                    |/                                                */
+
+#ifndef LILA_SPECIALIZER_H
+#define LILA_SPECIALIZER_H
+
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "ast.hpp"
+
+using namespace std;
+using namespace lila::ast;
+
+namespace lila {
+  namespace specializer {
+
+    // clone of a def for some constant arguments
+    class Specialization {
+    public:
+      Symbol name;
+      Binding binding;
+    };
+
+    // Clones defs for calls where some of the arguments are constants. The
+    // clone takes the remaining arguments, has the constants substituted in
+    // its body and is declared right after the original def, in the same
+    // frame. Run the folder afterwards to simplify the clones. Clones are
+    // shared by all calls with the same constants, and there is a budget of
+    // nodes all clones together may add to the AST.
+    class Specializer {
+    private:
+      SymbolTable &symbols;
+      AST *ast = nullptr;
+
+      // def and its constant arguments, as position and bits of the value
+      typedef pair<uint32_t, vector<pair<uint32_t, uint64_t> > > Signature;
+
+      // open frame: the block owning it, if any, the defs by slot and the
+      // clones to insert after their defs once the block is done
+      class Frame {
+      public:
+        Node block;
+        vector<Node> defs;
+        vector<pair<Node, Node> > clones;
+      };
+
+      // how to clone the body of a def of the frame at depth
+      class Substitution {
+      public:
+        uint32_t depth;
+        vector<Node> constants; // by argument, empty if not constant
+        vector<uint32_t> slots; // new slots of the remaining arguments
+      };
+
+      vector<Frame> frames;
+      map<Signature, Specialization> cache;
+
+      uint32_t budget;
+      const uint32_t maxDefSize;
+
+      Node specializeExpr(Node node);
+      void specializeBlock(Node node);
+      Node specializeBinary(Node node);
+      Node specializeCall(Node node);
+      void specializeDef(Node node);
+
+      bool specialize(Binding binding, const vector<Node> &args,
+                      Specialization &result, vector<Node> &remaining);
+
+      Node clone(Node node, const Substitution &substitution);
+      uint32_t size(Node node) const;
+
+    public:
+      explicit Specializer(SymbolTable &symbols, uint32_t budget = 4096, uint32_t maxDefSize = 256)
+        : symbols(symbols), budget(budget), maxDefSize(maxDefSize) {}
+
+      void specialize(AST &ast);
+    };
+
+  }
+}
+
+#endif
@@ -0,0 +1,60 @@
+/*            __ __                                                     *\
+**     __    /_// /  ___            lila bootstrap compiler             **
+**    / /   __ / /  / _ |           (c) 2016, Christian Krause          **
+**   / /__ / // /__/ __ |                                               **
+**  /____//_//____/_/ | |                                               **
+\*                    |/                                                */
+
+#ifndef LILA_SYMBOL_H
+#define LILA_SYMBOL_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+
+using namespace std;
+
+namespace lila {
+  namespace symbol {
+
+    // interned name, equal names have equal symbols
+    typedef uint32_t Symbol;
+
+    // Interns identifiers and operators. The lexer fills the table, parser,
+    // AST and code generator refer to names only by their symbol. One table
+    // is shared by all phases of a compilation.
+    class SymbolTable {
+    private:
+      llvm::StringMap<Symbol> ids;
+      vector<llvm::StringRef> names; // keys of ids, which owns the bytes
+
+    public:
+      Symbol intern(llvm::StringRef name) {
+        auto entry = ids.insert(make_pair(name, (Symbol) names.size()));
+
+        if (entry.second)
+          names.push_back(entry.first->getKey());
+
+        return entry.first->second;
+      }
+
+      llvm::StringRef name(Symbol symbol) const {
+        return names[symbol];
+      }
+
+      string str(Symbol symbol) const {
+        return names[symbol].str();
+      }
+
+      size_t size() const {
+        return names.size();
+      }
+    };
+
+  }
+}
+
+#endif
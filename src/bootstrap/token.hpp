@@ -8,119 +8,96 @@
 #ifndef LILA_TOKEN_H
 #define LILA_TOKEN_H
 
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <llvm/ADT/StringRef.h>
+
+#include "symbol.hpp"
+
 using namespace std;
+using namespace lila::symbol;
 
 namespace lila {
   namespace token {
 
-    class Token {
-    public:
-      virtual string toString() = 0;
-    };
-
-    class NumberToken : public Token {
-    public:
-      double value;
-      explicit NumberToken(const double &value) : value(value) {}
-      string toString() {
-        return to_string(value);
-      }
-    };
-
-    class OtherToken : public Token {
-    public:
-      string name;
-      explicit OtherToken(const string &name) : name(name) {}
-      string toString() {
-        return name;
-      }
+    enum class TokenKind : uint8_t {
+      Number,
+      Other,
+      BlockOpen,
+      BlockClose,
+      ParenOpen,
+      ParenClose,
+      Comma,
+      Dot,
+      Colon,
+      Value,
+      Def,
+      Assignment,
+      Newline,
+      End // never stored, marks the end of the stream
     };
 
-    class BlockClose : public Token {
-    public:
-      explicit BlockClose() {}
-      string toString() {
-        return "}";
-      }
+    union TokenValue {
+      double number; // Number tokens
+      Symbol symbol; // Other tokens, i.e. identifiers and operators
     };
 
-    class BlockOpen : public Token {
+    class Token {
     public:
-      explicit BlockOpen() {}
-      string toString() {
-        return "{";
-      }
+      TokenKind kind;
+      uint32_t offset; // byte range of the token in the source
+      uint32_t length;
+      TokenValue value;
     };
 
-    class ParenClose : public Token {
-    public:
-      explicit ParenClose() {}
-      string toString() {
-        return ")";
-      }
-    };
-
-    class ParenOpen : public Token {
-    public:
-      explicit ParenOpen() {}
-      string toString() {
-        return "(";
+    inline string toString(const Token &token, llvm::StringRef source) {
+      switch (token.kind) {
+      case TokenKind::Number:
+        return to_string(token.value.number);
+      case TokenKind::Newline:
+        return "\\n";
+      case TokenKind::End:
+        return "end of input";
+      default:
+        return source.substr(token.offset, token.length).str();
       }
-    };
+    }
 
-    class CommaToken : public Token {
+    // Tokens are stored column-wise: token i is described by kinds[i],
+    // offsets[i], lengths[i] and values[i].
+    class TokenStream {
     public:
-      explicit CommaToken() {}
-      string toString() {
-        return ",";
-      }
-    };
+      llvm::StringRef source;
+      vector<TokenKind> kinds;
+      vector<uint32_t> offsets;
+      vector<uint32_t> lengths;
+      vector<TokenValue> values;
 
-    class DotToken : public Token {
-    public:
-      explicit DotToken() {}
-      string toString() {
-        return ".";
-      }
-    };
+      explicit TokenStream(llvm::StringRef source) : source(source) {}
 
-    class ColonToken : public Token {
-    public:
-      explicit ColonToken() {}
-      string toString() {
-        return ":";
+      size_t size() const {
+        return kinds.size();
       }
-    };
 
-    class ValueToken : public Token {
-    public:
-      explicit ValueToken() {}
-      string toString() {
-        return "val";
+      void push(const Token &token) {
+        kinds.push_back(token.kind);
+        offsets.push_back(token.offset);
+        lengths.push_back(token.length);
+        values.push_back(token.value);
       }
-    };
 
-    class DefToken : public Token {
-    public:
-      explicit DefToken() {}
-      string toString() {
-        return "def";
+      Token get(size_t i) const {
+        return Token { kinds[i], offsets[i], lengths[i], values[i] };
       }
-    };
 
-    class AssignmentToken : public Token {
-    public:
-      explicit AssignmentToken() {}
-      string toString() {
-        return "=";
+      llvm::StringRef text(size_t i) const {
+        return source.substr(offsets[i], lengths[i]);
       }
-    };
 
-    class NewlineToken : public Token {
-    public:
-      explicit NewlineToken() {}
-      string toString() {
-        return "\\n";
+      string toString(size_t i) const {
+        return token::toString(get(i), source);
       }
     };
 
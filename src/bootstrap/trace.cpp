@@ -0,0 +1,218 @@
+/*            __ __                                                     *\
+**     __    /_// /  ___            lila bootstrap compiler             **
+**    / /   __ / /  / _ |           (c) 2016, Christian Krause          **
+**   / /__ / // /__/ __ |                                               **
+**  /____//_//____/_/ | |                                               **
+\*                    |/                                                */
+
+#include "trace.hpp"
+
+#include <sys/resource.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cstdio>
+
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+
+using namespace std;
+
+namespace lila {
+  namespace trace {
+
+    uint64_t threadCPUTime() {
+      timespec time;
+
+      if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0)
+        return 0;
+
+      return time.tv_sec * 1000000ull + time.tv_nsec / 1000;
+    }
+
+    uint64_t peakRSS() {
+      rusage usage;
+
+      if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+
+      // KiB on Linux
+      return usage.ru_maxrss;
+    }
+
+    static void writeJSONString(llvm::raw_ostream &out, llvm::StringRef str) {
+      out << '"';
+
+      for (char c : str) {
+        if (c == '"' || c == '\\') {
+          out << '\\' << c;
+        } else if ((unsigned char) c < 0x20) {
+          char escaped[8];
+          snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+          out << escaped;
+        } else {
+          out << c;
+        }
+      }
+
+      out << '"';
+    }
+
+    Trace::Scope::Scope(Trace *trace, const char *name, llvm::StringRef detail)
+      : trace(trace), name(name), detail(detail) {
+      if (trace) {
+        start = trace->now();
+        cpuStart = threadCPUTime();
+      }
+    }
+
+    void Trace::Scope::end() {
+      if (trace)
+        trace->record(name, detail, start, cpuStart);
+
+      trace = nullptr;
+    }
+
+    uint64_t Trace::now() const {
+      auto elapsed = chrono::steady_clock::now() - begin;
+      return chrono::duration_cast<chrono::microseconds>(elapsed).count();
+    }
+
+    void Trace::record(const char *name, llvm::StringRef detail, uint64_t start, uint64_t cpuStart) {
+      Event event;
+      event.name = name;
+      event.detail = detail;
+      event.start = start;
+      event.wall = now() - start;
+      event.cpu = threadCPUTime() - cpuStart;
+      event.peakRSS = peakRSS();
+
+      lock_guard<mutex> guard(lock);
+
+      auto thread = threads.insert(make_pair(this_thread::get_id(), threads.size()));
+      event.thread = thread.first->second;
+
+      events.push_back(move(event));
+    }
+
+    void Trace::count(const string &name, uint64_t value) {
+      lock_guard<mutex> guard(lock);
+
+      for (auto &counter : counters)
+        if (counter.first == name) {
+          counter.second += value;
+          return;
+        }
+
+      counters.push_back(make_pair(name, value));
+    }
+
+    bool Trace::write(const string &path, string &error) const {
+      std::error_code EC;
+      llvm::raw_fd_ostream out(path, EC, llvm::sys::fs::F_Text);
+
+      if (EC) {
+        error = EC.message();
+        return false;
+      }
+
+      lock_guard<mutex> guard(lock);
+
+      out << "{\"traceEvents\":[\n";
+
+      bool first = true;
+
+      for (auto &event : events) {
+        if (!first)
+          out << ",\n";
+        first = false;
+
+        out << "{\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+            << ",\"ts\":" << event.start << ",\"dur\":" << event.wall << ",\"name\":";
+        writeJSONString(out, event.name);
+        out << ",\"args\":{";
+        if (!event.detail.empty()) {
+          out << "\"detail\":";
+          writeJSONString(out, event.detail);
+          out << ",";
+        }
+        out << "\"cpu_us\":" << event.cpu << ",\"peak_rss_kib\":" << event.peakRSS << "}}";
+      }
+
+      uint64_t end = events.empty() ? 0 : events.back().start + events.back().wall;
+
+      for (auto &counter : counters) {
+        if (!first)
+          out << ",\n";
+        first = false;
+
+        out << "{\"ph\":\"C\",\"pid\":1,\"tid\":0,\"ts\":" << end << ",\"name\":";
+        writeJSONString(out, counter.first);
+        out << ",\"args\":{\"value\":" << counter.second << "}}";
+      }
+
+      out << "\n]}\n";
+      out.close();
+
+      bool failed = out.has_error();
+      out.clear_error();
+
+      if (failed)
+        error = "error writing " + path;
+
+      return !failed;
+    }
+
+    void Trace::summarize(ostream &out) const {
+      class Total {
+      public:
+        string name;
+        unsigned count;
+        uint64_t wall;
+        uint64_t cpu;
+        uint64_t peakRSS;
+      };
+
+      lock_guard<mutex> guard(lock);
+
+      // in the order the phases first ended
+      vector<Total> totals;
+
+      for (auto &event : events) {
+        auto total = find_if(totals.begin(), totals.end(), [&](const Total &total) {
+          return total.name == event.name;
+        });
+
+        if (total == totals.end()) {
+          totals.push_back(Total { event.name, 0, 0, 0, 0 });
+          total = totals.end() - 1;
+        }
+
+        total->count++;
+        total->wall += event.wall;
+        total->cpu += event.cpu;
+        total->peakRSS = max(total->peakRSS, event.peakRSS);
+      }
+
+      char line[256];
+
+      snprintf(line, sizeof(line), "%-24s %8s %12s %12s %14s",
+               "phase", "count", "wall ms", "cpu ms", "peak rss KiB");
+      out << "[time-trace] " << line << endl;
+
+      for (auto &total : totals) {
+        snprintf(line, sizeof(line), "%-24s %8u %12.3f %12.3f %14llu",
+                 total.name.c_str(), total.count, total.wall / 1000.0, total.cpu / 1000.0,
+                 (unsigned long long) total.peakRSS);
+        out << "[time-trace] " << line << endl;
+      }
+
+      for (auto &counter : counters) {
+        snprintf(line, sizeof(line), "%-24s %8llu", counter.first.c_str(),
+                 (unsigned long long) counter.second);
+        out << "[time-trace] " << line << endl;
+      }
+    }
+
+  }
+}
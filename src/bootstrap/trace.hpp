@@ -0,0 +1,94 @@
+/*            __ __                                                     *\
+**     __    /_// /  ___            lila bootstrap compiler             **
+**    / /   __ / /  / _ |           (c) 2016, Christian Krause          **
+**   / /__ / // /__/ __ |                                               **
+**  /____//_//____/_/ | |                                               **
+\*                    |/                                                */
+
+#ifndef LILA_TRACE_H
+#define LILA_TRACE_H
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <llvm/ADT/StringRef.h>
+
+namespace lila {
+  namespace trace {
+
+    // Wall time, CPU time of the thread and peak resident memory of the
+    // process for each phase of a compilation, and counters, e.g. of tokens
+    // and instructions. Written as Chrome trace events, which chrome://tracing
+    // and Perfetto show, and summed up per phase as text. Phases may be
+    // recorded by several threads at once.
+    class Trace {
+    private:
+      class Event {
+      public:
+        std::string name;
+        std::string detail;
+        unsigned thread;
+        uint64_t start;   // µs since the trace began
+        uint64_t wall;    // µs
+        uint64_t cpu;     // µs
+        uint64_t peakRSS; // KiB
+      };
+
+      const std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+      mutable std::mutex lock;
+      std::vector<Event> events;
+      std::vector<std::pair<std::string, uint64_t> > counters;
+      std::map<std::thread::id, unsigned> threads;
+
+      uint64_t now() const;
+
+      void record(const char *name, llvm::StringRef detail, uint64_t start, uint64_t cpuStart);
+
+    public:
+      // a phase from construction to end or destruction, nothing is recorded
+      // without a trace
+      class Scope {
+      private:
+        Trace *trace;
+        const char *name;
+        llvm::StringRef detail;
+        uint64_t start = 0;
+        uint64_t cpuStart = 0;
+
+      public:
+        Scope(Trace *trace, const char *name, llvm::StringRef detail = "");
+        ~Scope() { end(); }
+
+        Scope(const Scope&) = delete;
+        Scope &operator=(const Scope&) = delete;
+
+        void end();
+      };
+
+      // adds value to the counter of that name
+      void count(const std::string &name, uint64_t value);
+
+      // Chrome trace event JSON
+      bool write(const std::string &path, std::string &error) const;
+
+      // total time and peak memory of each phase and the counters
+      void summarize(std::ostream &out) const;
+    };
+
+    // CPU time of the calling thread in µs
+    uint64_t threadCPUTime();
+
+    // peak resident memory of the process in KiB
+    uint64_t peakRSS();
+
+  }
+}
+
+#endif
@@ -0,0 +1,23 @@
+#!/bin/bash
+
+source test-compilation.sh
+
+# errors are reported, but do not end the session, and later inputs see the
+# vals and defs of earlier ones
+cat << EOF | test_repl "$(printf '42\n42\n21\n42\n1')"
+20 + 22
+val x = 21
+def twice(a) = a * 2
+twice(x)
+
+def |> (a, b) = a * b + unknown
+x
+def |> (a, b) = {
+  val c = a * b
+  twice(c)
+}
+x |> 1
+
+val x = 1
+x
+EOF
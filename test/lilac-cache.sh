@@ -0,0 +1,46 @@
+#!/bin/bash
+
+source test-compilation.sh
+
+PROGRAM='
+def foo(a, b) = a * b
+
+foo(21, 2)
+'
+
+CACHE=$(mktemp -d)
+LOG=$(mktemp)
+OBJECT=$(mktemp)
+EXPECTED=$(mktemp)
+
+function cleanup {
+  rm -rf $CACHE $LOG $OBJECT $EXPECTED
+}
+
+trap cleanup EXIT
+
+echo "$PROGRAM" | test_compilation "42" --cache-dir=$CACHE 2> $LOG || exit 1
+grep -q '^\[cache\] miss' $LOG || exit 1
+
+# the same source and options are not compiled again
+echo "$PROGRAM" | test_compilation "42" --cache-dir=$CACHE 2> $LOG || exit 1
+grep -q '^\[cache\] hit' $LOG || exit 1
+grep -q '^\[ast\]' $LOG && exit 1
+
+# other options are another object
+echo "$PROGRAM" | test_compilation "42" -O0 --cache-dir=$CACHE 2> $LOG || exit 1
+grep -q '^\[cache\] miss' $LOG || exit 1
+
+# a cache of no size keeps nothing
+echo "$PROGRAM" | test_compilation "42" -O1 --cache-dir=$CACHE --cache-size=0 2> $LOG || exit 1
+[[ -z $(ls $CACHE) ]] || exit 1
+
+# an output linked to a cached object is replaced by a new object, the cached
+# one stays as it is
+echo "$PROGRAM" | $LILAC --cache-dir=$CACHE -o $OBJECT || exit 1
+cp $OBJECT $EXPECTED
+echo "$PROGRAM" | $LILAC --cache-dir=$CACHE -o $OBJECT || exit 1
+echo "21 + 22" | $LILAC --cache-dir=$CACHE -o $OBJECT || exit 1
+cmp -s $OBJECT $EXPECTED && exit 1
+echo "$PROGRAM" | $LILAC --cache-dir=$CACHE -o $OBJECT || exit 1
+cmp -s $OBJECT $EXPECTED || exit 1
@@ -0,0 +1,31 @@
+#!/bin/bash
+
+source test-compilation.sh
+
+PROGRAM='
+def square(x) = x * x
+
+square(6) + 6
+'
+
+OUTPUT=$(mktemp)
+
+function cleanup {
+  rm -f $OUTPUT
+}
+
+trap cleanup EXIT
+
+echo "$PROGRAM" | test_compilation "42" --emit=obj || exit 1
+
+echo "$PROGRAM" | $LILAC --emit=asm -o $OUTPUT || exit 1
+grep -q 'square:' $OUTPUT || exit 1
+
+echo "$PROGRAM" | $LILAC --emit=llvm -o $OUTPUT || exit 1
+grep -q '^define double @square(double' $OUTPUT || exit 1
+
+echo "$PROGRAM" | $LILAC --emit=bc -o $OUTPUT || exit 1
+[[ $(head -c 2 $OUTPUT) == BC ]] || exit 1
+
+echo "$PROGRAM" | $LILAC --emit=exe -o $OUTPUT 2> /dev/null && exit 1
+exit 0
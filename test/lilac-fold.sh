@@ -0,0 +1,42 @@
+#!/bin/bash
+
+source test-compilation.sh
+
+# the last expression of the program after folding
+function folded_result {
+  $LILAC -v -o /dev/null 2>&1 | sed -n '/^\[folded\]/,/^\[\/folded\]/p' | tail -n 3 | head -n 1
+}
+
+PROGRAM=$(
+  cat << EOF
+def twice(x) = x * 2
+def -: (a, b) = a - b
+
+def foo(a) = {
+  def bar(b) = twice(b) + 1
+  bar(a) -: 1
+}
+
+val x = { val y = 5
+  y * 2 }
+
+foo(x) + 22
+EOF
+)
+
+echo "$PROGRAM" | test_compilation "42" || exit 1
+
+# the call of foo and the block of x are evaluated at compile time
+[[ $(echo "$PROGRAM" | folded_result) =~ ^\ *42\.0*$ ]] || exit 1
+
+# too expensive to evaluate at compile time, left to the generated code
+PROGRAM=$(
+  echo "def f0(x) = x + 1"
+  for i in $(seq 1 20) ; do
+    echo "def f$i(x) = f$((i - 1))(x) + f$((i - 1))(x)"
+  done
+  echo "f20(0) - 1048534"
+)
+
+echo "$PROGRAM" | test_compilation "42" || exit 1
+[[ $(echo "$PROGRAM" | folded_result) =~ f20\(0\.0*\) ]] || exit 1
@@ -0,0 +1,69 @@
+#!/bin/bash
+
+source test-compilation.sh
+
+STATE=$(mktemp -d)
+CLEAN=$(mktemp -d)
+OBJECT=$(mktemp)
+REFERENCE=$(mktemp)
+
+function cleanup {
+  rm -rf $STATE $CLEAN $OBJECT $REFERENCE
+}
+
+trap cleanup EXIT
+
+function program {
+  echo "
+def foo(a) = a * 2
+def bar(a) = a + 20
+def baz(a) = a + 2
+def qux(a) = a * $1
+
+baz(foo(bar(0)))
+"
+}
+
+program 2 | test_compilation "42" -O0 --incremental=$STATE || exit 1
+PARTS=$(ls $STATE | wc -l)
+
+# a changed def is the only part compiled again
+program 3 | test_compilation "42" -O0 --incremental=$STATE || exit 1
+[[ $(ls $STATE | wc -l) == $((PARTS + 1)) ]] || exit 1
+
+# and the object is the one of a build from scratch
+program 3 | $LILAC -O0 --incremental=$STATE -o $OBJECT &&
+program 3 | $LILAC -O0 --incremental=$CLEAN -o $REFERENCE &&
+cmp -s $OBJECT $REFERENCE || exit 1
+
+for level in -O0 -O2 ; do
+  program 2 | test_compilation "42" $level --incremental=$STATE || exit 1
+done
+
+# specialized clones and nested defs are named after the defs they come from,
+# so a def added in front of them does not rename them into other parts
+function program2 {
+  echo "def poly(x, a) = x * a + 1"
+  [[ $1 == early ]] && echo "def early(x) = {
+  def inner(y) = y - 1
+  inner(x) + poly(x, 7)
+}"
+  echo "def outer(x) = {
+  def inner(y) = y * 2
+  inner(x) + poly(x, 3)
+}
+def other(x) = {
+  def inner(y) = y + 1
+  inner(x) * poly(x, 5)
+}
+
+outer(5) + other(1) + 4"
+}
+
+rm -rf $STATE/*
+program2 | test_compilation "42" -O2 --incremental=$STATE || exit 1
+PARTS=$(ls $STATE | wc -l)
+
+# the parts of early, its inner def and its clone of poly, at most
+program2 early | test_compilation "42" -O2 --incremental=$STATE || exit 1
+[[ $(ls $STATE | wc -l) -le $((PARTS + 3)) ]] || exit 1
@@ -0,0 +1,32 @@
+#!/bin/bash
+
+source test-compilation.sh
+
+DIR=$(mktemp -d)
+NAME=$(basename $DIR)
+
+function cleanup {
+  rm -rf $DIR $NAME-*.o
+}
+
+trap cleanup EXIT
+
+echo 'def foo(a) = a * 2
+foo(21)' > $DIR/$NAME-a.lila
+
+echo 'val x = 40
+x + 3' > $DIR/$NAME-b.lila
+
+echo 'val = 1' > $DIR/$NAME-c.lila
+
+# an object for each input, named after it
+for jobs in 1 2 ; do
+  $LILAC -j $jobs $DIR/$NAME-a.lila $DIR/$NAME-b.lila || exit 1
+  test_object "42" $NAME-a.o || exit 1
+  test_object "43" $NAME-b.o || exit 1
+  rm -f $NAME-*.o
+done
+
+# the others are compiled when one fails
+$LILAC $DIR/$NAME-a.lila $DIR/$NAME-c.lila $DIR/$NAME-b.lila 2> /dev/null && exit 1
+[[ -f $NAME-a.o && -f $NAME-b.o && ! -f $NAME-c.o ]] || exit 1
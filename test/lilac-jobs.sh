@@ -0,0 +1,34 @@
+#!/bin/bash
+
+source test-compilation.sh
+
+PROGRAM='
+def foo(a, b) = a * b
+def bar(a) = foo(a, 2) - 2
+def baz(a) = bar(a) + 2
+
+baz(21)
+'
+
+for level in -O0 -O2 ; do
+  for jobs in 1 4 ; do
+    echo "$PROGRAM" | test_compilation "42" $level -j $jobs || exit 1
+  done
+done
+
+# the object does not depend on the number of jobs
+ONE=$(mktemp)
+FOUR=$(mktemp)
+
+echo "$PROGRAM" | $LILAC -j 1 -o $ONE &&
+echo "$PROGRAM" | $LILAC -j 4 -o $FOUR &&
+cmp -s $ONE $FOUR &&
+
+# ld -r of the parts can not write to STDOUT itself
+echo "$PROGRAM" | $LILAC -j 4 -o - > $FOUR &&
+cmp -s $ONE $FOUR &&
+[[ ! -e - ]]
+RESULT=$?
+
+rm -f $ONE $FOUR
+exit $RESULT
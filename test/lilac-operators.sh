@@ -0,0 +1,12 @@
+#!/bin/bash
+
+source test-compilation.sh
+
+cat << EOF | test_compilation "42"
+def |> (a, b) = a * b
+def -: (a, b) = a - b
+
+val x = 10 -: 4 -: 2
+
+x - 2 |> 3 + 4
+EOF
@@ -0,0 +1,18 @@
+#!/bin/bash
+
+source test-compilation.sh
+
+PROGRAM='
+def square(x) = x * x
+
+def foo(a, b) = {
+  val c = square(a) - b
+  c * 2
+}
+
+foo(5, 4) - 0
+'
+
+for level in -O0 -O1 -O2 -O3 -Os -Oz ; do
+  echo "$PROGRAM" | test_compilation "42" $level || exit 1
+done
@@ -0,0 +1,16 @@
+#!/bin/bash
+
+source test-compilation.sh
+
+PROGRAM='
+def foo(a, b) = {
+  val c = a * b
+  c - 2
+}
+
+foo(21, 2) + 2
+'
+
+for level in -O0 -O2 ; do
+  echo "$PROGRAM" | test_run "42" $level || exit 1
+done
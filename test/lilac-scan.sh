@@ -0,0 +1,70 @@
+#!/bin/bash
+
+# The lexer scans runs 32 (AVX2) or 16 (SSE2) bytes at a time, or one byte at
+# a time with LILA_SCAN=scalar. All of them must produce the same tokens, so
+# the verbose output of each is compared with the one of the scalar scanner.
+
+source test-compilation.sh
+
+TMP=$(mktemp -d)
+trap 'rm -rf $TMP' EXIT
+
+# the programs of the other tests
+for t in *.sh ; do
+  [[ $t == lilac-scan.sh ]] && continue
+
+  awk -v out=$TMP/${t%.sh} '
+    /<< EOF/ { n++ ; copy = 1 ; next }
+    /^EOF$/  { copy = 0 }
+    copy     { print > (out "-" n ".lila") }' $t
+done
+
+# runs that end right before, at and right after the end of a block, shifted
+# by every offset within a block
+for shift in $(seq 0 33) ; do
+  pad=$(printf "%${shift}s" "")
+
+  for n in 15 16 17 31 32 33 47 48 49 64 ; do
+    digits=$(printf "%0${n}d" 7)
+    alnum=$(printf "x%.0s" $(seq 1 $n))
+    punct=$(printf "+%.0s" $(seq 1 $n))
+    blank=$(printf " %.0s" $(seq 1 $n))
+
+    printf "%s%s + 1.\n" "$pad" "$digits" >> $TMP/digits-$shift.lila
+    printf "%s%s.%s\n" "$pad" "$digits" "$digits" >> $TMP/digits-$shift.lila
+    printf "%s%s9 = %s\n" "$pad" "$alnum" "$alnum" >> $TMP/alnum-$shift.lila
+    printf "%s1 %s 2\n" "$pad" "$punct" >> $TMP/punct-$shift.lila
+    printf "%s1%s+\t%s2\n" "$pad" "$blank" "$blank" >> $TMP/blank-$shift.lila
+  done
+done
+
+# a trailing partial block, without a final newline
+printf "val abcdefghijklmnopqrstuvwxyz0123456789 = 1234567890.5\nabc" > $TMP/partial-1.lila
+printf "1 +++++++++++++++++++++++++++++++++++++" > $TMP/partial-2.lila
+printf "42                                     " > $TMP/partial-3.lila
+printf "4" > $TMP/partial-4.lila
+
+# lila has no comments, so what looks like one at the end is punctuation and
+# identifiers up to the end of the input
+printf "42\n// the answer" > $TMP/comment-1.lila
+printf "42\n# the answer\n" > $TMP/comment-2.lila
+printf "42 /* the answer */" > $TMP/comment-3.lila
+
+# bytes outside of ASCII are ignored like blanks, also within runs
+printf "val \xc3\xa4x = 1\xe2\x82\xac2\n\xc3\xa4x + 4\xf0\x9f\x98\x80\n" > $TMP/utf8.lila
+printf "abc\x80def\xff+\x7f+\x01 \x1b\t42\n" > $TMP/bytes-1.lila
+printf "%s\xfe%s\n" $(printf "y%.0s" $(seq 1 31)) $(printf "1%.0s" $(seq 1 40)) > $TMP/bytes-2.lila
+printf "1 \xa0\xa0\xa0\xa0\xa0\xa0\xa0\xa0\xa0\xa0\xa0\xa0\xa0\xa0\xa0\xa0\xa0\xa0\xa0\xa0\xa0\xa0\xa0\xa0\xa0\xa0\xa0\xa0\xa0\xa0\xa0\xa0\xa0+ 2" > $TMP/bytes-3.lila
+
+for program in $TMP/*.lila ; do
+  LILA_SCAN=scalar $LILAC -v -o /dev/null $program > $TMP/scalar.log 2>&1
+
+  for scan in sse2 avx2 ; do
+    LILA_SCAN=$scan $LILAC -v -o /dev/null $program > $TMP/$scan.log 2>&1
+
+    if ! grep -q "^\[token\]" $TMP/scalar.log || ! cmp -s $TMP/scalar.log $TMP/$scan.log ; then
+      echo "different tokens with $scan for $(basename $program)" >&2
+      exit 1
+    fi
+  done
+done
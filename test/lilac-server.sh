@@ -0,0 +1,62 @@
+#!/bin/bash
+
+source test-compilation.sh
+
+DIR=$(mktemp -d)
+SOCKET=$DIR/lilac.socket
+
+$LILAC --daemon=$SOCKET -v 2> $DIR/daemon.log &
+DAEMON=$!
+
+function cleanup {
+  kill $DAEMON 2> /dev/null
+  rm -rf $DIR
+}
+
+trap cleanup EXIT
+
+for i in $(seq 1 50) ; do
+  [[ -S $SOCKET ]] && break
+  sleep 0.1
+done
+
+# the source from STDIN
+echo "21 + 21" | test_compilation "42" --server=$SOCKET || exit 1
+
+# paths relative to the directory of the client
+cat > $DIR/def.lila << EOL
+def foo(a, b) = a * b
+
+foo(21, 2)
+EOL
+
+LILAC=$PWD/$LILAC
+
+(cd $DIR && $LILAC --server=$SOCKET -o def.o def.lila) || exit 1
+test_object "42" $DIR/def.o || exit 1
+
+grep -q "def.lila -> $DIR/def.o" $DIR/daemon.log || exit 1
+
+# diagnostics of the server
+echo "21 + )" | $LILAC --server=$SOCKET -o $DIR/error.o 2>&1 | grep -q '^\[lexer\] \[error\]' || exit 1
+
+# without a server
+echo "21 + 21" | test_compilation "42" --server=$DIR/none || exit 1
+
+# a server that does not greet the client is not handed the request, so the
+# client compiles on its own and the server does not write the output later
+cp $DIR/def.lila $DIR/stopped.lila
+kill -STOP $DAEMON
+$LILAC --server=$SOCKET -o $DIR/stopped.o $DIR/stopped.lila || exit 1
+test_object "42" $DIR/stopped.o || exit 1
+kill -CONT $DAEMON
+
+(cd $DIR && $LILAC --server=$SOCKET -o def.o def.lila) || exit 1
+sleep 1
+! grep -q "stopped.lila" $DIR/daemon.log || exit 1
+
+# the server removes its socket
+kill $DAEMON
+wait $DAEMON
+
+[[ ! -e $SOCKET ]] || exit 1
@@ -0,0 +1,20 @@
+#!/bin/bash
+
+source test-compilation.sh
+
+cat << EOF | test_compilation "42"
+val x = 2
+
+def f(a) = {
+  val a = a + 1
+  def g(b) = b * x
+  g(a)
+}
+
+def h(a) = {
+  def f(b) = b + 32
+  f(a)
+}
+
+f(2) + h(x) + x
+EOF
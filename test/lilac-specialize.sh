@@ -0,0 +1,46 @@
+#!/bin/bash
+
+source test-compilation.sh
+
+# calls of f0 are too many to evaluate at compile time, so the clones of
+# poly and |> for constant arguments run in the generated code
+PROGRAM=$(
+  cat << EOF
+def poly(x, a, b) = {
+  val y = x * a
+  y * x + b
+}
+
+def |> (a, b) = a * b + poly(a, b, 1)
+
+def f0(x) = poly(x, 3, 2) - (x |> 2) - (2 |> x) + 1
+EOF
+  for i in $(seq 1 18) ; do
+    echo "def f$i(x) = f$((i - 1))(x) + f$((i - 1))(x)"
+  done
+  echo "f18(1) + 1572906"
+)
+
+for level in -O0 -O2 ; do
+  echo "$PROGRAM" | test_compilation "42" $level || exit 1
+done
+
+# the def of f0 after folding and specializing
+function folded_f0 {
+  echo "$PROGRAM" | $LILAC -v $1 -o /dev/null 2>&1 | sed -n '/^\[folded\]/,/^\[\/folded\]/p' | grep "def f0("
+}
+
+# f0 calls clones without the constant arguments instead of poly and |>
+F0=$(folded_f0 -O2)
+
+[[ $F0 =~ poly\.[0-9a-f.]+\(x\) ]] || exit 1
+[[ $F0 =~ \|\>\.[0-9a-f.]+\(x\) ]] || exit 1
+[[ $F0 =~ poly\( || $F0 =~ \ \|\>\  ]] && exit 1
+
+# no clones at -O0
+F0=$(folded_f0 -O0)
+
+[[ $F0 =~ poly\(x,\ 3\.0*,\ 2\.0*\) ]] || exit 1
+[[ $F0 =~ \.[0-9a-f]+\( ]] && exit 1
+
+exit 0
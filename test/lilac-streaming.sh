@@ -0,0 +1,14 @@
+#!/bin/bash
+
+source test-compilation.sh
+
+cat << EOF | test_compilation "42" -s
+val a = 21
+
+def foo(a, b) = {
+  val c = a * b
+  c - 2
+}
+
+foo(a, 2) + 2
+EOF
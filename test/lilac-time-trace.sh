@@ -0,0 +1,41 @@
+#!/bin/bash
+
+source test-compilation.sh
+
+PROGRAM='
+def foo(a, b) = a * b
+
+foo(21, 2)
+'
+
+TRACE=$(mktemp)
+SUMMARY=$(mktemp)
+
+function cleanup {
+  rm -f $TRACE $SUMMARY
+}
+
+trap cleanup EXIT
+
+echo "$PROGRAM" | test_compilation "42" --time-trace=$TRACE 2> $SUMMARY || exit 1
+
+grep -q '^{"traceEvents":\[' $TRACE || exit 1
+
+for phase in tokenize parse resolve fold codegen verify optimize emit ; do
+  grep -q "\"name\":\"$phase\"" $TRACE || exit 1
+  grep -q "^\[time-trace\] $phase " $SUMMARY || exit 1
+done
+
+grep -q '"name":"optimize function","args":{"detail":"foo"' $TRACE || exit 1
+grep -q '"ph":"C".*"name":"tokens"' $TRACE || exit 1
+grep -q '^\[time-trace\] emitted bytes ' $SUMMARY || exit 1
+
+# also for the parts of a split object
+echo "$PROGRAM" | test_compilation "42" -j 2 --time-trace=$TRACE 2> $SUMMARY || exit 1
+
+for phase in "inline module" "optimize part" "emit part" ; do
+  grep -q "\"name\":\"$phase\"" $TRACE || exit 1
+  grep -q "^\[time-trace\] $phase " $SUMMARY || exit 1
+done
+
+grep -q '"name":"optimize function","args":{"detail":"foo"' $TRACE || exit 1